@@ -0,0 +1,119 @@
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+// drops every string at once - the memory is kept for the next snapshot.
+// bumping the generation invalidates the whole intern table without touching it
+void arena_reset(StringArena *arena) {
+    arena->used = 0;
+    if (arena->data) {
+        arena->data[0] = '\0';
+        arena->used = 1;
+    }
+
+    arena->live = 0;
+    if (++arena->gen == 0) {
+        // wrapped around, old stamps could look current again
+        if (arena->slots) memset(arena->slots, 0, sizeof(InternSlot) * arena->slot_count);
+        arena->gen = 1;
+    }
+}
+
+void arena_free(StringArena *arena) {
+    free(arena->data);
+    free(arena->slots);
+    memset(arena, 0, sizeof(*arena));
+}
+
+// copies len bytes of str (plus a NUL) into the arena, returns its offset.
+// on allocation failure the string is dropped and the empty string returned
+unsigned int arena_add(StringArena *arena, const char *str, size_t len) {
+    if (len == 0) return 0;
+
+    if (arena->used == 0) {
+        // first use, reserve offset 0 for ""
+        arena_reset(arena);
+        if (!arena->data) arena->used = 1;
+    }
+
+    if (arena->used + len + 1 > arena->size) {
+        size_t new_size = arena->size ? arena->size : 16384;
+        while (arena->used + len + 1 > new_size) new_size *= 2;
+
+        char *new_data = realloc(arena->data, new_size);
+        if (!new_data) return 0;
+        if (!arena->data) new_data[0] = '\0';
+        arena->data = new_data;
+        arena->size = new_size;
+    }
+
+    unsigned int offset = (unsigned int)arena->used;
+    memcpy(arena->data + offset, str, len);
+    arena->data[offset + len] = '\0';
+    arena->used += len + 1;
+    return offset;
+}
+
+static unsigned int hash_bytes(const char *str, size_t len) {
+    unsigned int h = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)str[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static InternSlot* find_intern_slot(StringArena *arena, unsigned int hash, const char *str, size_t len) {
+    unsigned int mask = arena->slot_count - 1;
+    unsigned int i = hash & mask;
+    while (arena->slots[i].gen == arena->gen) {
+        InternSlot *s = &arena->slots[i];
+        if (s->hash == hash && s->len == len && memcmp(arena->data + s->offset, str, len) == 0) return s;
+        i = (i + 1) & mask;
+    }
+    return &arena->slots[i];
+}
+
+// doubles the intern table, carrying over this generation's slots
+static int grow_intern_table(StringArena *arena) {
+    unsigned int new_count = arena->slot_count ? arena->slot_count * 2 : 1024;
+    InternSlot *new_slots = calloc(new_count, sizeof(InternSlot));
+    if (!new_slots) return -1;
+
+    unsigned int mask = new_count - 1;
+    for (unsigned int i = 0; i < arena->slot_count; i++) {
+        if (arena->slots[i].gen != arena->gen) continue;
+        unsigned int j = arena->slots[i].hash & mask;
+        while (new_slots[j].gen == arena->gen) j = (j + 1) & mask;
+        new_slots[j] = arena->slots[i];
+    }
+
+    free(arena->slots);
+    arena->slots = new_slots;
+    arena->slot_count = new_count;
+    return 0;
+}
+
+// like arena_add, but a string that's already in the arena is stored only once
+unsigned int arena_intern(StringArena *arena, const char *str, size_t len) {
+    if (len == 0) return 0;
+    if (arena->gen == 0) arena_reset(arena);
+
+    if ((arena->live + 1) * 2 > arena->slot_count && grow_intern_table(arena) != 0) {
+        return arena_add(arena, str, len); // no table, just don't dedupe
+    }
+
+    unsigned int hash = hash_bytes(str, len);
+    InternSlot *slot = find_intern_slot(arena, hash, str, len);
+    if (slot->gen == arena->gen) return slot->offset;
+
+    unsigned int offset = arena_add(arena, str, len);
+    if (offset == 0) return 0;
+
+    slot->hash = hash;
+    slot->offset = offset;
+    slot->len = (unsigned int)len;
+    slot->gen = arena->gen;
+    arena->live++;
+    return offset;
+}
@@ -0,0 +1,37 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// intern table slot - only slots stamped with the arena's current generation are live
+typedef struct {
+    unsigned int hash;
+    unsigned int offset;
+    unsigned int len;
+    unsigned int gen;
+} InternSlot;
+
+// bump allocator for a snapshot's strings. strings are addressed by offset
+// (so the buffer can grow) and offset 0 is always the empty string.
+// arena_intern() stores each distinct string once; resetting drops all
+// strings and the intern table in O(1)
+typedef struct {
+    char *data;
+    size_t used;
+    size_t size;
+    InternSlot *slots;
+    unsigned int slot_count; // power of two
+    unsigned int live;       // interned strings this generation
+    unsigned int gen;
+} StringArena;
+
+unsigned int arena_add(StringArena *arena, const char *str, size_t len);
+unsigned int arena_intern(StringArena *arena, const char *str, size_t len);
+void arena_reset(StringArena *arena);
+void arena_free(StringArena *arena);
+
+static inline const char* arena_str(const StringArena *arena, unsigned int offset) {
+    return arena->data ? arena->data + offset : "";
+}
+
+#endif
@@ -0,0 +1,97 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "process_list.h"
+
+// tiny benchmark for the /proc collector, run with `make bench`
+// usage: ./prcsmgr-bench [iterations] [collector threads, 0 = auto] [events] [taskstats] [lazy] [io] [cgroups]
+// "events" feeds the PID set from the proc connector instead of readdir,
+// "taskstats" reads CPU times etc. through the taskstats backend, "lazy"
+// skips status/cmdline like the UI does for rows that aren't on screen,
+// "io" also reads /proc/<pid>/io for the I/O rate columns, "cgroups"
+// /proc/<pid>/cgroup for new processes (and a slice of the rest)
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+int main(int argc, char **argv) {
+    int iterations = 200;
+    if (argc > 1) iterations = atoi(argv[1]);
+    if (iterations < 1) iterations = 1;
+    int threads = 0;
+    if (argc > 2) threads = atoi(argv[2]);
+    set_collector_threads(threads);
+    int events = 0, taskstats = 0, lazy = 0, io = 0, cgroups = 0;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "events") == 0) events = 1;
+        if (strcmp(argv[i], "taskstats") == 0) taskstats = 1;
+        if (strcmp(argv[i], "lazy") == 0) lazy = 1;
+        if (strcmp(argv[i], "io") == 0) io = 1;
+        if (strcmp(argv[i], "cgroups") == 0) cgroups = 1;
+    }
+    if (lazy) set_collector_wanted(NULL, 0);
+    set_collector_io(io);
+    set_collector_cgroups(cgroups);
+    if (events && proc_events_start() != 0) {
+        fprintf(stderr, "proc connector unavailable, scanning /proc\n");
+        events = 0;
+    }
+    if (taskstats && set_collector_backend(BACKEND_TASKSTATS) != 0) {
+        fprintf(stderr, "taskstats unavailable, parsing /proc\n");
+        taskstats = 0;
+    }
+
+    ProcessList *list = create_process_list();
+    ProcessList *prev_list = create_process_list();
+    if (!list || !prev_list) {
+        fprintf(stderr, "Failed to create process list\n");
+        return 1;
+    }
+
+    // warm up so the first run doesn't pay for page cache / dentries. it's
+    // also the one refresh that reads everything, nothing can be carried over yet
+    double first = now_ms();
+    refresh_process_list(prev_list, NULL);
+    printf("first refresh: %.3f ms\n", now_ms() - first);
+
+    double start = now_ms();
+    for (int i = 0; i < iterations; i++) {
+        refresh_process_list(list, prev_list);
+        ProcessList *tmp = prev_list;
+        prev_list = list;
+        list = tmp;
+    }
+    double elapsed = now_ms() - start;
+
+    printf("refresh_process_list: %d processes, %d runs, %d threads%s%s%s%s, %s, %.3f ms/refresh\n",
+           prev_list->count, iterations, threads, events ? ", events" : "", lazy ? ", lazy" : "", io ? ", io" : "", cgroups ? ", cgroups" : "",
+           taskstats ? "taskstats" : "procfs", elapsed / iterations);
+
+    // what the UI does with every snapshot in tree view
+    prev_list->sort_mode = SORT_CPU;
+    prev_list->tree_mode = 1;
+    start = now_ms();
+    for (int i = 0; i < iterations; i++) sort_process_list(prev_list);
+    printf("sort + tree: %.3f ms\n", (now_ms() - start) / iterations);
+
+    // how much the interned text arena saves over one copy per row
+    size_t raw = 0;
+    for (int i = 0; i < prev_list->count; i++) {
+        raw += strlen(arena_str(&prev_list->text, prev_list->name[i])) + 1;
+        raw += strlen(arena_str(&prev_list->text, prev_list->user[i])) + 1;
+        raw += strlen(arena_str(&prev_list->text, prev_list->command[i])) + 1;
+    }
+    printf("text: %.1f KB in the arena, %.1f KB without interning\n",
+           prev_list->text.used / 1024.0, raw / 1024.0);
+
+    proc_events_stop();
+    collector_shutdown();
+    free_process_list(list);
+    free_process_list(prev_list);
+    return 0;
+}
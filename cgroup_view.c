@@ -0,0 +1,207 @@
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "sort.h"
+#include "cgroup_view.h"
+
+typedef struct {
+    CgroupInfo info;
+    unsigned int from;             // the path's offset in the snapshot, the group-by key
+    unsigned int path;             // offset in this update's arena
+    unsigned int hash;             // of the path, for finding it again next update
+    unsigned long long usage_usec; // cpu.stat, from the snapshot's CgroupStats
+    int usage_ok;
+} Group;
+
+static int active = 0;
+
+// two generations: this update's groups and the last one's, which has
+// the cpu.stat readings the CPU % is worked out against. each keeps its
+// paths in its own arena, the snapshot they came from goes back to the sampler
+static Group *groups[2];
+static int group_count[2];
+static int group_cap[2];
+static StringArena arenas[2];
+static int *path_index[2];         // path hash -> group, -1 = empty, power of two
+static unsigned int path_index_size[2];
+static int cur = 0;
+static unsigned long long last_ms = 0; // sample_ms of the last update's snapshot
+
+static int *by_offset = NULL;      // snapshot cgroup offset -> group, -1 = empty
+static unsigned int by_offset_size = 0;
+static int *order = NULL;          // busiest first
+static SortKey *keys = NULL;       // 2 * order_cap
+static int order_cap = 0;
+
+static unsigned int hash_path(const char *s) {
+    unsigned int h = 2166136261u; // FNV-1a
+    for (; *s; s++) h = (h ^ (unsigned char)*s) * 16777619u;
+    return h;
+}
+
+static unsigned int hash_offset(unsigned int off) {
+    return off * 2654435761u;
+}
+
+// the same cgroup in the last update, -1 if it's new
+static int find_prev(const char *path, unsigned int hash) {
+    int p = cur;
+    if (!path_index[p]) return -1;
+    unsigned int mask = path_index_size[p] - 1;
+    for (unsigned int i = hash & mask; path_index[p][i] >= 0; i = (i + 1) & mask) {
+        const Group *g = &groups[p][path_index[p][i]];
+        if (g->hash == hash && strcmp(arena_str(&arenas[p], g->path), path) == 0) return path_index[p][i];
+    }
+    return -1;
+}
+
+static int reserve_ints(int **table, unsigned int *size, unsigned int want) {
+    unsigned int n = 64;
+    while (n < want) n *= 2;
+    if (n > *size) {
+        int *p = realloc(*table, sizeof(int) * n);
+        if (!p) return -1;
+        *table = p;
+        *size = n;
+    }
+    memset(*table, -1, sizeof(int) * *size);
+    return 0;
+}
+
+static int add_group(int c, unsigned int from, const char *path) {
+    if (group_count[c] == group_cap[c]) {
+        int cap = group_cap[c] ? group_cap[c] * 2 : 64;
+        Group *p = realloc(groups[c], sizeof(Group) * cap);
+        if (!p) return -1;
+        groups[c] = p;
+        group_cap[c] = cap;
+    }
+    Group *g = &groups[c][group_count[c]];
+    memset(g, 0, sizeof(*g));
+    g->from = from;
+    g->path = arena_add(&arenas[c], path, strlen(path));
+    g->hash = hash_path(path);
+    g->info.cpu = -1.0f;
+    g->info.memory = -1;
+    g->info.pressure = -1.0f;
+    return group_count[c]++;
+}
+
+void cgroup_view_update(const ProcessList *list) {
+    if (!active) return;
+
+    unsigned long long now = list->sample_ms;
+    int c = cur ^ 1;
+    arena_reset(&arenas[c]);
+    group_count[c] = 0;
+
+    // group-by: cgroup paths are interned in the snapshot, so the same
+    // path is the same offset and the key is just an integer
+    if (reserve_ints(&by_offset, &by_offset_size, (unsigned int)list->count * 2) != 0) return;
+    unsigned int mask = by_offset_size - 1;
+    for (int i = 0; i < list->count; i++) {
+        unsigned int off = list->cgroup[i];
+        unsigned int slot = hash_offset(off) & mask;
+        while (by_offset[slot] >= 0 && groups[c][by_offset[slot]].from != off) slot = (slot + 1) & mask;
+        if (by_offset[slot] < 0) {
+            by_offset[slot] = add_group(c, off, arena_str(&list->text, off));
+            if (by_offset[slot] < 0) return;
+        }
+        Group *g = &groups[c][by_offset[slot]];
+        g->info.procs++;
+        g->info.proc_cpu += list->cpu_usage[i];
+        g->info.rss += list->memory_sq[i];
+    }
+
+    // the sampler read each cgroup's own files into the snapshot, they
+    // go with the group of the same offset
+    for (int k = 0; k < list->cgroup_stats_count; k++) {
+        const CgroupStats *st = &list->cgroup_stats[k];
+        unsigned int slot = hash_offset(st->path) & mask;
+        while (by_offset[slot] >= 0 && groups[c][by_offset[slot]].from != st->path) slot = (slot + 1) & mask;
+        if (by_offset[slot] < 0) continue;
+        Group *g = &groups[c][by_offset[slot]];
+        g->usage_usec = st->usage_usec;
+        g->usage_ok = st->usage_ok;
+        g->info.memory = st->memory;
+        g->info.pressure = st->pressure;
+    }
+
+    int n = group_count[c];
+    if (reserve_ints(&path_index[c], &path_index_size[c], (unsigned int)n * 2) != 0) return;
+    unsigned int path_mask = path_index_size[c] - 1;
+    for (int k = 0; k < n; k++) {
+        Group *g = &groups[c][k];
+        const char *path = arena_str(&arenas[c], g->path); // the arena is done growing
+        g->info.path = path;
+
+        int prev = find_prev(path, g->hash);
+        if (prev >= 0 && last_ms && g->usage_ok && groups[cur][prev].usage_ok &&
+            g->usage_usec >= groups[cur][prev].usage_usec && now > last_ms) {
+            g->info.cpu = (float)((g->usage_usec - groups[cur][prev].usage_usec) * 100.0 / ((now - last_ms) * 1000.0));
+        }
+
+        unsigned int slot = g->hash & path_mask;
+        while (path_index[c][slot] >= 0) slot = (slot + 1) & path_mask;
+        path_index[c][slot] = k;
+    }
+
+    if (n > order_cap) {
+        int *o = realloc(order, sizeof(int) * n);
+        if (!o) return;
+        order = o;
+        SortKey *sk = realloc(keys, sizeof(SortKey) * n * 2);
+        if (!sk) return;
+        keys = sk;
+        order_cap = n;
+    }
+    for (int k = 0; k < n; k++) {
+        const CgroupInfo *info = &groups[c][k].info;
+        keys[k].key = ~float_sort_key(info->cpu >= 0 ? info->cpu : info->proc_cpu) & 0xffffffffull;
+        keys[k].index = k;
+    }
+    radix_sort_keys(keys, keys + n, n);
+    for (int k = 0; k < n; k++) order[k] = keys[k].index;
+
+    cur = c;
+    last_ms = now;
+}
+
+void cgroup_view_open(void) {
+    active = 1;
+    group_count[0] = group_count[1] = 0;
+    last_ms = 0;
+}
+
+void cgroup_view_close(void) {
+    active = 0;
+    for (int c = 0; c < 2; c++) {
+        free(groups[c]);
+        groups[c] = NULL;
+        group_count[c] = group_cap[c] = 0;
+        arena_free(&arenas[c]);
+        free(path_index[c]);
+        path_index[c] = NULL;
+        path_index_size[c] = 0;
+    }
+    free(by_offset);
+    by_offset = NULL;
+    by_offset_size = 0;
+    free(order);
+    free(keys);
+    order = NULL;
+    keys = NULL;
+    order_cap = 0;
+}
+
+int cgroup_view_active(void) {
+    return active;
+}
+
+int cgroup_view_count(void) {
+    return active ? group_count[cur] : 0;
+}
+
+const CgroupInfo *cgroup_view_row(int i) {
+    return &groups[cur][order[i]].info;
+}
@@ -0,0 +1,33 @@
+#ifndef CGROUP_VIEW_H
+#define CGROUP_VIEW_H
+
+#include "process_list.h"
+
+// processes grouped by cgroup v2 path (systemd units, containers), with
+// the cgroup's own numbers from /sys/fs/cgroup next to the totals of the
+// processes in it. the grouping is one hash pass over a snapshot, the
+// /sys files are read by the sampler into the snapshot's CgroupStats
+// while the view is open (sampler_want_cgroups)
+
+typedef struct {
+    const char *path;             // "" = not in a v2 cgroup (v1-only host)
+    int procs;
+    float proc_cpu;               // CPU % of its processes, summed
+    long unsigned int rss;        // their RSS, KB
+    float cpu;                    // from cpu.stat, % of one core, -1 = unreadable
+    long long memory;             // memory.current in KB, -1 = unreadable
+    float pressure;               // memory.pressure "some" avg10, -1 = unreadable
+} CgroupInfo;
+
+void cgroup_view_open(void);
+void cgroup_view_close(void);
+int cgroup_view_active(void);
+
+// regroups a new snapshot, does nothing while the view is closed
+void cgroup_view_update(const ProcessList *list);
+
+// busiest first
+int cgroup_view_count(void);
+const CgroupInfo *cgroup_view_row(int i);
+
+#endif
@@ -0,0 +1,133 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "cpu_stats.h"
+
+// opened once, re-read with pread() - only ever used by whoever is refreshing
+static int stat_fd = -1;
+static char *buf = NULL;
+static size_t buf_size = 0;
+
+static const char* parse_ull(const char *p, unsigned long long *out) {
+    while (*p == ' ') p++;
+    unsigned long long v = 0;
+    while (*p >= '0' && *p <= '9') v = v * 10 + (unsigned long long)(*p++ - '0');
+    *out = v;
+    return p;
+}
+
+// the numbers of one "cpu" line, fields an older kernel doesn't have stay 0
+static const char* parse_times(const char *p, CpuTimes *t) {
+    unsigned long long v[10] = {0};
+    for (int i = 0; i < 10 && *p && *p != '\n'; i++) p = parse_ull(p, &v[i]);
+
+    t->user = v[0];
+    t->nice = v[1];
+    t->system = v[2];
+    t->idle = v[3];
+    t->iowait = v[4];
+    t->irq = v[5];
+    t->softirq = v[6];
+    t->steal = v[7];
+    t->guest = v[8];
+    t->guest_nice = v[9];
+
+    while (*p && *p != '\n') p++;
+    if (*p) p++;
+    return p;
+}
+
+static int grow_cores(CpuStats *st, int n) {
+    int new_cap = st->core_capacity ? st->core_capacity : 64;
+    while (new_cap < n) new_cap *= 2;
+
+    CpuTimes *c = realloc(st->cores, sizeof(CpuTimes) * new_cap);
+    if (!c) return -1;
+    st->cores = c;
+    float *f = realloc(st->core_percents, sizeof(float) * new_cap);
+    if (!f) return -1;
+    st->core_percents = f;
+
+    memset(st->cores + st->core_capacity, 0, sizeof(CpuTimes) * (new_cap - st->core_capacity));
+    memset(st->core_percents + st->core_capacity, 0, sizeof(float) * (new_cap - st->core_capacity));
+    st->core_capacity = new_cap;
+    return 0;
+}
+
+// whole /proc/stat into buf. the cpu lines come first, the buffer only has
+// to grow until they (and the "intr" line after them) fit
+static ssize_t read_stat(void) {
+    if (!buf) {
+        buf_size = 16384;
+        buf = malloc(buf_size);
+        if (!buf) return -1;
+    }
+
+    while (1) {
+        size_t used = 0;
+        ssize_t n = 0;
+        while (used < buf_size - 1 && (n = pread(stat_fd, buf + used, buf_size - 1 - used, used)) > 0) {
+            used += n;
+        }
+        if (n < 0 && used == 0) return -1;
+        buf[used] = '\0';
+
+        if (used < buf_size - 1 || strstr(buf, "\nintr ")) return used;
+
+        char *p = realloc(buf, buf_size * 2);
+        if (!p) return used; // parse what we have
+        buf = p;
+        buf_size *= 2;
+    }
+}
+
+int cpu_stats_read(CpuStats *st) {
+    if (stat_fd < 0) stat_fd = open("/proc/stat", O_RDONLY | O_CLOEXEC);
+    if (stat_fd < 0 || read_stat() <= 0) return -1;
+
+    const char *p = buf;
+    if (strncmp(p, "cpu ", 4) != 0) return -1;
+    p = parse_times(p + 3, &st->total);
+
+    int count = 0;
+    while (strncmp(p, "cpu", 3) == 0) {
+        unsigned long long n;
+        p = parse_ull(p + 3, &n);
+        if (n >= 65536) break; // garbage, not a CPU number
+
+        if ((int)n >= st->core_capacity && grow_cores(st, (int)n + 1) != 0) return -1;
+        // offline CPUs have no line at all
+        for (int i = count; i < (int)n; i++) memset(&st->cores[i], 0, sizeof(CpuTimes));
+
+        p = parse_times(p, &st->cores[n]);
+        count = (int)n + 1;
+    }
+    st->core_count = count;
+    return 0;
+}
+
+// busy % of every core between prev and cur, into cur->core_percents
+void cpu_stats_usage(CpuStats *cur, const CpuStats *prev) {
+    for (int i = 0; i < cur->core_count; i++) {
+        cur->core_percents[i] = 0;
+        if (!prev || i >= prev->core_count) continue;
+
+        unsigned long long old_total = cpu_times_total(&prev->cores[i]);
+        unsigned long long total = cpu_times_total(&cur->cores[i]);
+        if (old_total == 0 || total <= old_total) continue;
+
+        unsigned long long diff_total = total - old_total;
+        unsigned long long diff_idle = cpu_times_idle(&cur->cores[i]) - cpu_times_idle(&prev->cores[i]);
+        if (diff_idle <= diff_total) {
+            cur->core_percents[i] = (float)(diff_total - diff_idle) / diff_total * 100.0f;
+        }
+    }
+}
+
+void cpu_stats_free(CpuStats *st) {
+    free(st->cores);
+    free(st->core_percents);
+    memset(st, 0, sizeof(*st));
+}
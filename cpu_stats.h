@@ -0,0 +1,42 @@
+#ifndef CPU_STATS_H
+#define CPU_STATS_H
+
+// /proc/stat, read once per refresh and shared by the system CPU gauge,
+// per-process CPU% and the per-core view. core arrays grow with the
+// machine, there's no fixed core limit
+
+typedef struct {
+    unsigned long long user;       // includes guest
+    unsigned long long nice;       // includes guest_nice
+    unsigned long long system;
+    unsigned long long idle;
+    unsigned long long iowait;
+    unsigned long long irq;
+    unsigned long long softirq;
+    unsigned long long steal;
+    unsigned long long guest;
+    unsigned long long guest_nice;
+} CpuTimes;
+
+typedef struct {
+    CpuTimes total;         // the "cpu" line
+    CpuTimes *cores;        // "cpuN" lines at index N, offline CPUs stay zero
+    float *core_percents;   // busy % per core since the previous read, see cpu_stats_usage()
+    int core_count;         // highest N + 1
+    int core_capacity;
+} CpuStats;
+
+int cpu_stats_read(CpuStats *st);
+void cpu_stats_usage(CpuStats *cur, const CpuStats *prev);
+void cpu_stats_free(CpuStats *st);
+
+// guest time is already part of user/nice, so it's not added again
+static inline unsigned long long cpu_times_total(const CpuTimes *t) {
+    return t->user + t->nice + t->system + t->idle + t->iowait + t->irq + t->softirq + t->steal;
+}
+
+static inline unsigned long long cpu_times_idle(const CpuTimes *t) {
+    return t->idle + t->iowait;
+}
+
+#endif
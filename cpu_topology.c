@@ -0,0 +1,117 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include "cpu_topology.h"
+
+static int read_int_file(const char *path, int *out) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    int ok = fscanf(f, "%d", out) == 1;
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+// "0-47,96-143" -> node[cpu] = id for every CPU in the list
+static void apply_cpulist(const char *list, int id, int *node, int cpu_count) {
+    const char *p = list;
+    while (*p >= '0' && *p <= '9') {
+        char *end;
+        long lo = strtol(p, &end, 10), hi = lo;
+        if (*end == '-') hi = strtol(end + 1, &end, 10);
+        for (long c = lo; c <= hi && c < cpu_count; c++) node[c] = id;
+        p = *end == ',' ? end + 1 : end;
+    }
+}
+
+static void read_numa_nodes(int *node, int cpu_count) {
+    DIR *dir = opendir("/sys/devices/system/node");
+    if (!dir) return;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir))) {
+        int id;
+        if (sscanf(ent->d_name, "node%d", &id) != 1) continue;
+
+        char path[300], list[4096];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/%s/cpulist", ent->d_name);
+        FILE *f = fopen(path, "r");
+        if (!f) continue;
+        if (fgets(list, sizeof(list), f)) apply_cpulist(list, id, node, cpu_count);
+        fclose(f);
+    }
+    closedir(dir);
+}
+
+static const CpuTopology *sort_topo; // qsort has no context argument
+
+static int cmp_cpu(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    if (sort_topo->node[x] != sort_topo->node[y]) return sort_topo->node[x] - sort_topo->node[y];
+    if (sort_topo->package[x] != sort_topo->package[y]) return sort_topo->package[x] - sort_topo->package[y];
+    return x - y;
+}
+
+static int alloc_topology(CpuTopology *t, int cpu_count) {
+    cpu_topology_free(t);
+    t->package = malloc(sizeof(int) * (cpu_count + 1));
+    t->node = malloc(sizeof(int) * (cpu_count + 1));
+    t->order = malloc(sizeof(int) * (cpu_count + 1));
+    t->group_start = malloc(sizeof(int) * (cpu_count + 2));
+    if (!t->package || !t->node || !t->order || !t->group_start) {
+        cpu_topology_free(t);
+        return -1;
+    }
+    t->cpu_count = cpu_count;
+    return 0;
+}
+
+// splits the sorted order into runs of the same node + package
+static void build_groups(CpuTopology *t) {
+    for (int i = 0; i < t->cpu_count; i++) t->order[i] = i;
+    sort_topo = t;
+    qsort(t->order, t->cpu_count, sizeof(int), cmp_cpu);
+
+    t->group_count = 0;
+    for (int i = 0; i < t->cpu_count; i++) {
+        int c = t->order[i];
+        if (i == 0 || t->node[c] != t->node[t->order[i - 1]] || t->package[c] != t->package[t->order[i - 1]]) {
+            t->group_start[t->group_count++] = i;
+        }
+    }
+    t->group_start[t->group_count] = t->cpu_count;
+}
+
+int cpu_topology_load(CpuTopology *t, int cpu_count) {
+    if (alloc_topology(t, cpu_count) != 0) return -1;
+
+    for (int i = 0; i < cpu_count; i++) {
+        char path[96];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", i);
+        if (read_int_file(path, &t->package[i]) != 0) t->package[i] = -1;
+        t->node[i] = 0;
+    }
+    read_numa_nodes(t->node, cpu_count);
+
+    build_groups(t);
+    return 0;
+}
+
+// one group with every CPU in order, for when the layout isn't this machine's (replays)
+void cpu_topology_flat(CpuTopology *t, int cpu_count) {
+    if (alloc_topology(t, cpu_count) != 0) return;
+    for (int i = 0; i < cpu_count; i++) {
+        t->package[i] = -1;
+        t->node[i] = 0;
+    }
+    build_groups(t);
+}
+
+void cpu_topology_free(CpuTopology *t) {
+    free(t->package);
+    free(t->node);
+    free(t->order);
+    free(t->group_start);
+    memset(t, 0, sizeof(*t));
+}
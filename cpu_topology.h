@@ -0,0 +1,20 @@
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+// which socket and NUMA node every CPU sits on, from /sys/devices/system.
+// read once (and again when the CPU count changes), never per refresh
+
+typedef struct {
+    int cpu_count;
+    int *package;      // physical_package_id per CPU, -1 = unknown/offline
+    int *node;         // NUMA node per CPU, 0 if the box has no NUMA info
+    int *order;        // CPUs grouped by node, then package, then number
+    int *group_start;  // group g is order[group_start[g] .. group_start[g+1])
+    int group_count;
+} CpuTopology;
+
+int cpu_topology_load(CpuTopology *t, int cpu_count);
+void cpu_topology_flat(CpuTopology *t, int cpu_count);
+void cpu_topology_free(CpuTopology *t);
+
+#endif
@@ -0,0 +1,357 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "headless.h"
+
+// everything for one snapshot is formatted into `out` and written with a
+// single write(), so lines from different snapshots never interleave and
+// a 250 ms interval costs next to nothing. numbers are formatted by hand,
+// printf is most of the cost otherwise
+
+typedef struct {
+    char *data;
+    size_t used;
+    size_t size;
+} OutBuf;
+
+// makes room for n more bytes - only grows when the process count does
+static int reserve(OutBuf *b, size_t n) {
+    if (b->used + n <= b->size) return 0;
+
+    size_t new_size = b->size ? b->size : 65536;
+    while (b->used + n > new_size) new_size *= 2;
+    char *p = realloc(b->data, new_size);
+    if (!p) return -1;
+    b->data = p;
+    b->size = new_size;
+    return 0;
+}
+
+// callers reserve() first - a row never needs more than its strings plus ~256 bytes
+static void put_str(OutBuf *b, const char *s, size_t len) {
+    memcpy(b->data + b->used, s, len);
+    b->used += len;
+}
+
+#define PUT_LIT(b, lit) put_str((b), (lit), sizeof(lit) - 1)
+
+static void put_char(OutBuf *b, char c) {
+    b->data[b->used++] = c;
+}
+
+static void put_ull(OutBuf *b, unsigned long long v) {
+    char tmp[24];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n > 0) b->data[b->used++] = tmp[--n];
+}
+
+static void put_long(OutBuf *b, long long v) {
+    if (v < 0) {
+        put_char(b, '-');
+        v = -v;
+    }
+    put_ull(b, (unsigned long long)v);
+}
+
+// one decimal, like the UI shows
+static void put_fixed1(OutBuf *b, double v) {
+    if (v < 0) {
+        put_char(b, '-');
+        v = -v;
+    }
+    unsigned long long tenths = (unsigned long long)(v * 10.0 + 0.5);
+    put_ull(b, tenths / 10);
+    put_char(b, '.');
+    put_char(b, (char)('0' + tenths % 10));
+}
+
+// worst case every byte becomes \u00XX
+static size_t json_str_max(const char *s) {
+    return strlen(s) * 6 + 2;
+}
+
+// length of the well-formed UTF-8 sequence at s, 0 if it isn't one
+// (stray continuation byte, overlong form, surrogate, past U+10FFFF)
+static int utf8_len(const unsigned char *s) {
+    unsigned char c = s[0];
+    int len;
+    unsigned char lo = 0x80, hi = 0xbf; // allowed range of the second byte
+    if (c >= 0xc2 && c <= 0xdf) len = 2;
+    else if (c >= 0xe0 && c <= 0xef) {
+        len = 3;
+        if (c == 0xe0) lo = 0xa0;
+        if (c == 0xed) hi = 0x9f;
+    } else if (c >= 0xf0 && c <= 0xf4) {
+        len = 4;
+        if (c == 0xf0) lo = 0x90;
+        if (c == 0xf4) hi = 0x8f;
+    } else return 0;
+
+    if (s[1] < lo || s[1] > hi) return 0;
+    for (int i = 2; i < len; i++) {
+        if ((s[i] & 0xc0) != 0x80) return 0;
+    }
+    return len;
+}
+
+// command lines are whatever bytes the process was started with, anything
+// that isn't valid UTF-8 becomes U+FFFD so the line still parses as JSON
+static void put_json_str(OutBuf *b, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+    put_char(b, '"');
+    while (*s) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            put_char(b, '\\');
+            put_char(b, (char)c);
+        } else if (c < 0x20 || c == 0x7f) {
+            PUT_LIT(b, "\\u00");
+            put_char(b, hex[c >> 4]);
+            put_char(b, hex[c & 15]);
+        } else if (c >= 0x80) {
+            int len = utf8_len((const unsigned char *)s);
+            if (len == 0) {
+                PUT_LIT(b, "\\ufffd");
+            } else {
+                for (int i = 0; i < len; i++) put_char(b, s[i]);
+                s += len;
+                continue;
+            }
+        } else {
+            put_char(b, (char)c);
+        }
+        s++;
+    }
+    put_char(b, '"');
+}
+
+static size_t csv_str_max(const char *s) {
+    return strlen(s) * 2 + 2;
+}
+
+// always quoted, quotes doubled, newlines flattened so a row stays a line
+static void put_csv_str(OutBuf *b, const char *s) {
+    put_char(b, '"');
+    for (; *s; s++) {
+        if (*s == '"') put_char(b, '"');
+        put_char(b, (*s == '\n' || *s == '\r') ? ' ' : *s);
+    }
+    put_char(b, '"');
+}
+
+static unsigned long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// every mode by name, no default - a new SortMode gets a -Wswitch warning here
+static const char* sort_name(SortMode mode) {
+    switch (mode) {
+        case SORT_PID: return "pid";
+        case SORT_MEM: return "mem";
+        case SORT_CPU: return "cpu";
+        case SORT_PSS: return "pss";
+        case SORT_IO:  return "io";
+    }
+    return "pid";
+}
+
+static int format_json(OutBuf *b, const ProcessList *list, const SystemInfo *sys,
+                       int rows, unsigned long long ts, SortMode mode) {
+    if (reserve(b, 1024 + json_str_max(sys->hostname)) != 0) return -1;
+
+    PUT_LIT(b, "{\"ts\":");
+    put_ull(b, ts);
+    PUT_LIT(b, ",\"host\":");
+    put_json_str(b, sys->hostname);
+    PUT_LIT(b, ",\"cpu\":");
+    put_fixed1(b, sys->cpu_percent);
+    PUT_LIT(b, ",\"cpu_steal\":");
+    put_fixed1(b, sys->cpu_steal);
+    PUT_LIT(b, ",\"cpu_guest\":");
+    put_fixed1(b, sys->cpu_guest);
+    PUT_LIT(b, ",\"mem_total_kb\":");
+    put_ull(b, sys->mem_total);
+    PUT_LIT(b, ",\"mem_used_kb\":");
+    put_ull(b, sys->mem_used);
+    PUT_LIT(b, ",\"load\":[");
+    for (int i = 0; i < 3; i++) {
+        if (i) put_char(b, ',');
+        put_fixed1(b, sys->load_avg[i]);
+    }
+    PUT_LIT(b, "],\"processes\":");
+    put_ull(b, list->count);
+    PUT_LIT(b, ",\"sort\":\"");
+    put_str(b, sort_name(mode), strlen(sort_name(mode)));
+    PUT_LIT(b, "\",\"procs\":[");
+
+    for (int row = 0; row < rows; row++) {
+        ProcessInfo info;
+        ProcessInfo *p = visible_process(list, row, &info);
+        if (reserve(b, 256 + json_str_max(p->name) + json_str_max(p->user) +
+                       json_str_max(p->command)) != 0) return -1;
+
+        if (row) put_char(b, ',');
+        PUT_LIT(b, "{\"pid\":");
+        put_long(b, p->pid);
+        PUT_LIT(b, ",\"ppid\":");
+        put_long(b, p->ppid);
+        PUT_LIT(b, ",\"user\":");
+        put_json_str(b, p->user);
+        PUT_LIT(b, ",\"name\":");
+        put_json_str(b, p->name);
+        PUT_LIT(b, ",\"state\":\"");
+        put_char(b, p->state);
+        PUT_LIT(b, "\",\"rss_kb\":");
+        put_ull(b, p->memory_sq);
+        PUT_LIT(b, ",\"cpu\":");
+        put_fixed1(b, p->cpu_usage);
+        PUT_LIT(b, ",\"threads\":");
+        put_long(b, p->threads);
+        PUT_LIT(b, ",\"cmd\":");
+        put_json_str(b, p->command);
+        put_char(b, '}');
+    }
+
+    if (reserve(b, 4) != 0) return -1;
+    PUT_LIT(b, "]}\n");
+    return 0;
+}
+
+// one row per process, the snapshot timestamp ties rows of a snapshot together
+static int format_csv(OutBuf *b, const ProcessList *list, int rows, unsigned long long ts) {
+    for (int row = 0; row < rows; row++) {
+        ProcessInfo info;
+        ProcessInfo *p = visible_process(list, row, &info);
+        if (reserve(b, 256 + csv_str_max(p->name) + csv_str_max(p->user) +
+                       csv_str_max(p->command)) != 0) return -1;
+
+        put_ull(b, ts);
+        put_char(b, ',');
+        put_long(b, p->pid);
+        put_char(b, ',');
+        put_long(b, p->ppid);
+        put_char(b, ',');
+        put_csv_str(b, p->user);
+        put_char(b, ',');
+        put_csv_str(b, p->name);
+        put_char(b, ',');
+        put_char(b, p->state);
+        put_char(b, ',');
+        put_ull(b, p->memory_sq);
+        put_char(b, ',');
+        put_fixed1(b, p->cpu_usage);
+        put_char(b, ',');
+        put_long(b, p->threads);
+        put_char(b, ',');
+        put_csv_str(b, p->command);
+        put_char(b, '\n');
+    }
+    return 0;
+}
+
+// writes the whole buffer - normally in one go, a pipe can take less
+static int flush_out(OutBuf *b) {
+    size_t off = 0;
+    while (off < b->used) {
+        ssize_t n = write(STDOUT_FILENO, b->data + off, b->used - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1; // EPIPE etc, whoever read us is gone
+        }
+        off += n;
+    }
+    b->used = 0;
+    return 0;
+}
+
+static void sleep_until(struct timespec *deadline, int interval_ms) {
+    deadline->tv_sec += interval_ms / 1000;
+    deadline->tv_nsec += (long)(interval_ms % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+    // absolute deadline, so the collection time doesn't make the interval drift
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL) == EINTR) {}
+}
+
+int run_headless(const HeadlessOptions *opts) {
+    // a closed pipe should end the loop, not kill us mid-write
+    signal(SIGPIPE, SIG_IGN);
+
+    ProcessList *list = create_process_list();
+    ProcessList *prev_list = create_process_list();
+    OutBuf out = {0};
+    int rc = 1;
+
+    if (!list || !prev_list || reserve(&out, 65536) != 0) {
+        fprintf(stderr, "Failed to create process list\n");
+        goto done;
+    }
+
+    if (opts->format == OUTPUT_CSV) {
+        PUT_LIT(&out, "ts,pid,ppid,user,name,state,rss_kb,cpu,threads,cmd\n");
+    }
+
+    // baseline so the first emitted snapshot already has CPU and disk rates
+    SystemInfo baseline = {0};
+    refresh_process_list(prev_list, NULL);
+    get_system_info(&baseline, prev_list, NULL);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    for (long n = 0; opts->iterations == 0 || n < opts->iterations; n++) {
+        sleep_until(&deadline, opts->interval_ms);
+
+        SystemInfo sys = {0};
+        refresh_process_list(list, prev_list);
+        get_system_info(&sys, list, prev_list);
+
+        if (opts->recorder && recorder_write(opts->recorder, list, &sys) != 0) {
+            perror("recording");
+            goto done;
+        }
+
+        list->sort_mode = opts->sort_mode;
+        sort_process_list(list);
+        int rows = list->visible_count;
+        if (opts->top > 0 && rows > opts->top) rows = opts->top;
+
+        unsigned long long ts = now_ms();
+        int err = 0;
+        if (opts->format == OUTPUT_CSV) {
+            err = format_csv(&out, list, rows, ts);
+        } else if (opts->format == OUTPUT_JSON) {
+            err = format_json(&out, list, &sys, rows, ts, opts->sort_mode);
+        }
+        if (err != 0) {
+            fprintf(stderr, "out of memory\n");
+            goto done;
+        }
+        if (flush_out(&out) != 0) break;
+
+        ProcessList *tmp = prev_list;
+        prev_list = list;
+        list = tmp;
+    }
+    rc = 0;
+
+done:
+    collector_shutdown();
+    free(out.data);
+    free_process_list(list);
+    free_process_list(prev_list);
+    return rc;
+}
@@ -0,0 +1,28 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "process_list.h"
+#include "record.h"
+
+// non-interactive mode: one line of JSON (or a block of CSV rows) per
+// snapshot on stdout, for piping into log shippers and friends.
+// never touches ncurses
+
+typedef enum {
+    OUTPUT_JSON,
+    OUTPUT_CSV,
+    OUTPUT_NONE     // nothing on stdout, only useful with a recorder
+} OutputFormat;
+
+typedef struct {
+    OutputFormat format;
+    int interval_ms;
+    int top;            // only the first N processes in sort order, 0 = all
+    SortMode sort_mode;
+    long iterations;    // snapshots to emit, 0 = until killed / stdout closes
+    Recorder *recorder; // every snapshot is also appended here, if set
+} HeadlessOptions;
+
+int run_headless(const HeadlessOptions *opts);
+
+#endif
@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <string.h>
+#include "history.h"
+
+typedef struct {
+    pid_t pid;
+    unsigned long long starttime;  // tells a reused PID from the old process
+    unsigned long seen;            // tick of the last sample
+    int head;                      // where the next sample goes
+    int count;
+    float cpu[HISTORY_LEN];
+    unsigned long mem[HISTORY_LEN];
+} HistSlot;
+
+static HistSlot *slots = NULL;
+static int capacity = 0;
+static int *live = NULL;        // slots in use, dense so the sweep only walks those
+static int live_count = 0;
+static int *free_slots = NULL;
+static int free_count = 0;
+static int *index_table = NULL; // PID -> slot, -1 = empty, power of two
+static int index_size = 0;
+static unsigned long tick = 0;
+
+static unsigned int hash_pid(pid_t pid) {
+    return (unsigned int)pid * 2654435761u;
+}
+
+static int index_find(pid_t pid) {
+    unsigned int mask = (unsigned int)index_size - 1;
+    unsigned int i = hash_pid(pid) & mask;
+    while (index_table[i] != -1) {
+        if (slots[index_table[i]].pid == pid) return index_table[i];
+        i = (i + 1) & mask;
+    }
+    return -1;
+}
+
+static void index_insert(int slot) {
+    unsigned int mask = (unsigned int)index_size - 1;
+    unsigned int i = hash_pid(slots[slot].pid) & mask;
+    while (index_table[i] != -1) i = (i + 1) & mask;
+    index_table[i] = slot;
+}
+
+// backward-shift delete, so lookups never have to step over tombstones
+static void index_remove(pid_t pid) {
+    unsigned int mask = (unsigned int)index_size - 1;
+    unsigned int i = hash_pid(pid) & mask;
+    while (index_table[i] != -1 && slots[index_table[i]].pid != pid) i = (i + 1) & mask;
+    if (index_table[i] == -1) return;
+
+    unsigned int j = i;
+    while (1) {
+        j = (j + 1) & mask;
+        if (index_table[j] == -1) break;
+        unsigned int home = hash_pid(slots[index_table[j]].pid) & mask;
+        // j can fill the hole unless its home lies cyclically in (i, j]
+        int stays = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+        if (!stays) {
+            index_table[i] = index_table[j];
+            i = j;
+        }
+    }
+    index_table[i] = -1;
+}
+
+// sizes everything for n processes. only called at startup and when the
+// process count hits a new high, never on a normal tick
+static int reserve(int n) {
+    if (n <= capacity) return 0;
+    int new_cap = capacity ? capacity : 256;
+    while (new_cap < n) new_cap *= 2;
+
+    HistSlot *s = realloc(slots, sizeof(HistSlot) * new_cap);
+    if (!s) return -1;
+    slots = s;
+    int *l = realloc(live, sizeof(int) * new_cap);
+    if (!l) return -1;
+    live = l;
+    int *f = realloc(free_slots, sizeof(int) * new_cap);
+    if (!f) return -1;
+    free_slots = f;
+    int *t = realloc(index_table, sizeof(int) * new_cap * 2);
+    if (!t) return -1;
+    index_table = t;
+
+    // new slots go on the free list, lowest first out
+    for (int i = new_cap - 1; i >= capacity; i--) free_slots[free_count++] = i;
+    capacity = new_cap;
+    index_size = new_cap * 2;
+
+    memset(index_table, -1, sizeof(int) * index_size);
+    for (int i = 0; i < live_count; i++) index_insert(live[i]);
+    return 0;
+}
+
+int history_init(int n) {
+    return reserve(n);
+}
+
+// appends one sample per process in the snapshot and drops the ones that are gone
+void history_record(const ProcessList *list) {
+    // room for everything we have plus a completely new set of processes
+    if (reserve(live_count + list->count) != 0) return;
+    tick++;
+
+    for (int i = 0; i < list->count; i++) {
+        int s = index_find(list->pid[i]);
+        HistSlot *h;
+        if (s < 0) {
+            s = free_slots[--free_count];
+            live[live_count++] = s;
+            h = &slots[s];
+            h->pid = list->pid[i];
+            h->starttime = list->starttime[i];
+            h->head = 0;
+            h->count = 0;
+            index_insert(s);
+        } else {
+            h = &slots[s];
+            if (h->starttime != list->starttime[i]) {
+                h->starttime = list->starttime[i]; // PID was reused, start over
+                h->head = 0;
+                h->count = 0;
+            }
+        }
+
+        h->cpu[h->head] = list->cpu_usage[i];
+        h->mem[h->head] = list->memory_sq[i];
+        h->head = (h->head + 1) % HISTORY_LEN;
+        if (h->count < HISTORY_LEN) h->count++;
+        h->seen = tick;
+    }
+
+    // whatever didn't get a sample this tick has exited
+    for (int k = 0; k < live_count; ) {
+        int s = live[k];
+        if (slots[s].seen == tick) {
+            k++;
+            continue;
+        }
+        index_remove(slots[s].pid);
+        free_slots[free_count++] = s;
+        live[k] = live[--live_count];
+    }
+}
+
+// copies the samples of a process into cpu/mem (HISTORY_LEN each), oldest
+// first, and returns how many there are
+int history_get(pid_t pid, unsigned long long starttime, float *cpu, unsigned long *mem) {
+    if (!slots) return 0;
+    int s = index_find(pid);
+    if (s < 0 || slots[s].starttime != starttime) return 0;
+
+    const HistSlot *h = &slots[s];
+    int start = (h->head - h->count + HISTORY_LEN) % HISTORY_LEN;
+    for (int i = 0; i < h->count; i++) {
+        int j = (start + i) % HISTORY_LEN;
+        cpu[i] = h->cpu[j];
+        mem[i] = h->mem[j];
+    }
+    return h->count;
+}
+
+// forgets every process, e.g. when replay jumps to another point in time
+void history_clear(void) {
+    free_count = 0;
+    for (int i = capacity - 1; i >= 0; i--) free_slots[free_count++] = i;
+    live_count = 0;
+    if (index_table) memset(index_table, -1, sizeof(int) * index_size);
+}
+
+void history_free(void) {
+    free(slots);
+    free(live);
+    free(free_slots);
+    free(index_table);
+    slots = NULL;
+    live = free_slots = index_table = NULL;
+    capacity = live_count = free_count = index_size = 0;
+}
@@ -0,0 +1,19 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "process_list.h"
+
+// last HISTORY_LEN CPU/memory samples of every live process, for the
+// sparklines in the details sidebar. rings live in one preallocated slab
+// indexed by PID - recording a snapshot never allocates, and exited PIDs
+// go back on a free list at the end of the tick they disappeared in
+
+#define HISTORY_LEN 64
+
+int history_init(int capacity);
+void history_record(const ProcessList *list);
+int history_get(pid_t pid, unsigned long long starttime, float *cpu, unsigned long *mem);
+void history_clear(void);
+void history_free(void);
+
+#endif
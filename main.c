@@ -1,41 +1,472 @@
+#define _POSIX_C_SOURCE 200809L
+#include "cgroup_view.h"
+#include "headless.h"
+#include "history.h"
+#include "proc_events.h"
 #include "process_list.h"
+#include "record.h"
+#include "sampler.h"
+#include "thread_view.h"
 #include "ui.h"
+#include "user_cache.h"
 #include <ncurses.h>
 #include <signal.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 // TODO: network stats?
 // FIXME: selection jumps when filtering? fixed? ::: FIXED BTW
 // WTF it's sunday again
 
-int main() {
-  // double buffering - basically we keep 2 lists to compare CPU usage
-  ProcessList *list = create_process_list();
-  ProcessList *prev_list = create_process_list();
+#define REFRESH_INTERVAL_MS 1000
+#define SMAPS_BUDGET_MS 10
 
-  if (!list || !prev_list) {
+static void usage(const char *prog) {
+  fprintf(stderr, "usage: %s [-e] [-c procfs|taskstats] [-j threads] [-i ms] [-m ms] [-w file] [-S] [-P]\n", prog);
+  fprintf(stderr, "       %s -o json|csv|none [-n top] [-s pid|mem|cpu] [-N count] [-i ms] [-w file] [-P]\n", prog);
+  fprintf(stderr, "       %s -r file\n", prog);
+  fprintf(stderr, "  -e     track process start/exit with the kernel proc connector\n");
+  fprintf(stderr, "         (needs CAP_NET_ADMIN, falls back to polling /proc)\n");
+  fprintf(stderr, "  -c     where per-process stats come from (default: procfs).\n");
+  fprintf(stderr, "         taskstats adds delay accounting, needs CAP_NET_ADMIN\n");
+  fprintf(stderr, "  -j N   threads used to scan /proc (default: auto)\n");
+  fprintf(stderr, "  -i MS  refresh interval (default: %d)\n", REFRESH_INTERVAL_MS);
+  fprintf(stderr, "  -m MS  time per refresh spent reading PSS/USS/swap from\n");
+  fprintf(stderr, "         smaps_rollup (default: %d, 0 = off)\n", SMAPS_BUDGET_MS);
+  fprintf(stderr, "  -o FMT no UI, print a snapshot per interval to stdout as\n");
+  fprintf(stderr, "         json (one object per line) or csv (one row per process)\n");
+  fprintf(stderr, "  -n N   with -o, only the top N processes\n");
+  fprintf(stderr, "  -s KEY with -o, sort by pid, mem or cpu (default: cpu)\n");
+  fprintf(stderr, "  -N N   with -o, stop after N snapshots\n");
+  fprintf(stderr, "  -w F   also record every snapshot to file F\n");
+  fprintf(stderr, "  -r F   replay a recording made with -w\n");
+  fprintf(stderr, "  -S     show bytes sent to the terminal and draw time per frame\n");
+  fprintf(stderr, "  -P     keep user names cached even when /etc/passwd changes\n");
+}
+
+// clamps the selection to the filtered view and scrolls it into sight
+static void clamp_selection(const ProcessList *list, int *selected_index, int *scroll_offset) {
+  if (*selected_index >= list->visible_count)
+    *selected_index = list->visible_count - 1;
+  if (*selected_index < 0)
+    *selected_index = 0;
+
+  // make sure selected item is visible
+  int height, width;
+  getmaxyx(stdscr, height, width);
+  (void)width; // shut up compiler
+
+  int list_height = height - 14;
+  if (list_height < 1)
+    list_height = 1;
+
+  if (*selected_index < *scroll_offset) {
+    *scroll_offset = *selected_index;
+  } else if (*selected_index >= *scroll_offset + list_height) {
+    *scroll_offset = *selected_index - list_height + 1;
+  }
+}
+
+// what the UI carries over from one snapshot to the next
+typedef struct {
+  SortMode sort_mode;
+  int tree_mode;
+  char filter[256];
+  pid_t selected_pid;
+} ViewState;
+
+static void save_view(const ProcessList *list, int selected_index, ViewState *view) {
+  view->sort_mode = list->sort_mode;
+  view->tree_mode = list->tree_mode;
+  memcpy(view->filter, list->filter, sizeof(view->filter));
+  view->selected_pid = -1;
+  if (selected_index < list->visible_count) {
+    view->selected_pid = visible_pid(list, selected_index);
+  }
+}
+
+// sorts/filters a fresh snapshot like the last one, trying to keep the same process selected
+static void apply_snapshot(ProcessList *list, const ViewState *view, int *selected_index,
+                           int *scroll_offset) {
+  list->sort_mode = view->sort_mode;
+  list->tree_mode = view->tree_mode;
+  memcpy(list->filter, view->filter, sizeof(list->filter));
+  sort_process_list(list);
+
+  // if filter returns nothing, clear it
+  if (list->visible_count == 0 && list->filter[0] != '\0') {
+    list->filter[0] = '\0';
+    reset_search_mode();
+    apply_filter(list);
+  }
+
+  int row = view->selected_pid != -1 ? find_visible_row(list, view->selected_pid) : -1;
+  if (row >= 0)
+    *selected_index = row;
+
+  clamp_selection(list, selected_index, scroll_offset);
+}
+
+#define WANT_MAX 512
+
+// tells the sampler which processes are on screen - only those get their
+// user and command line read. a filter searches every row, so then it's
+// all of them. if the new set shows stand-ins, the sampler goes early
+static void want_visible_rows(Sampler *sampler, const ProcessList *list, int scroll_offset) {
+  static pid_t last[WANT_MAX];
+  static int last_count = -2;
+  pid_t pids[WANT_MAX];
+  int count = -1;
+
+  if (list->filter[0] == '\0') {
+    int height, width;
+    getmaxyx(stdscr, height, width);
+    (void)width;
+    count = 0;
+    for (int row = scroll_offset; row < list->visible_count && row < scroll_offset + height - 14 &&
+                                  count < WANT_MAX; row++)
+      pids[count++] = visible_pid(list, row);
+  }
+
+  if (count == last_count && (count <= 0 || memcmp(pids, last, sizeof(pid_t) * count) == 0))
+    return;
+  last_count = count;
+  if (count > 0)
+    memcpy(last, pids, sizeof(pid_t) * count);
+  sampler_want(sampler, count < 0 ? NULL : pids, count);
+
+  int stale = 0;
+  if (count < 0) {
+    for (int i = 0; i < list->count && !stale; i++)
+      stale = !list->enriched[i];
+  } else {
+    for (int row = scroll_offset; row < scroll_offset + count && !stale; row++)
+      stale = !list->enriched[list->visible[row]];
+  }
+  if (stale)
+    sampler_request_refresh(sampler);
+}
+
+static void replay_status(const Replay *rp, int frame, int paused, char *buf, size_t size) {
+  unsigned long long ts = replay_frame_time(rp, frame);
+  time_t secs = (time_t)(ts / 1000);
+  struct tm tm;
+  char when[32];
+  localtime_r(&secs, &tm);
+  strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+  snprintf(buf, size, "REPLAY %s | %d/%d%s | Space:Pause | Left/Right:10s | ,/.:Step | PgUp/PgDn:5min",
+           when, frame + 1, replay_frame_count(rp), paused ? " [paused]" : "");
+}
+
+// plays a recording back through the normal UI. frames go by at the pace
+// they were recorded, the arrows and friends jump around in it
+static int run_replay(const char *path) {
+  Replay *rp = replay_open(path);
+  if (!rp) {
+    fprintf(stderr, "%s: not a recording\n", path);
+    return 1;
+  }
+  if (replay_frame_count(rp) == 0) {
+    fprintf(stderr, "%s: recording is empty\n", path);
+    replay_close(rp);
+    return 1;
+  }
+
+  // decode into the one we're not showing, so the view can be carried over
+  ProcessList *lists[2] = {create_process_list(), create_process_list()};
+  if (!lists[0] || !lists[1]) {
     fprintf(stderr, "Failed to create process list\n");
     return 1;
   }
+  ProcessList *list = lists[0];
+  list->sort_mode = SORT_PID;
 
   init_ui();
+  history_init(1024);
+
+  int selected_index = 0;
+  int scroll_offset = 0;
+  int frame = 0;
+  int shown = -1;
+  int paused = 0;
+  SystemInfo sys_info = {0};
+  ViewState view;
+  char status[160];
+  struct timespec next_step;
+  clock_gettime(CLOCK_MONOTONIC, &next_step);
+  int needs_redraw = 1;
+
+  while (1) {
+    if (frame != shown) {
+      save_view(list, selected_index, &view);
+      ProcessList *next = list == lists[0] ? lists[1] : lists[0];
+      if (replay_seek(rp, frame, next, &sys_info) == 0) {
+        list = next;
+        apply_snapshot(list, &view, &selected_index, &scroll_offset);
+        // sparklines only make sense for frames played in order
+        if (frame != shown + 1)
+          history_clear();
+        history_record(list);
+      }
+      shown = frame;
+      needs_redraw = 1;
+    }
+
+    if (needs_redraw) {
+      replay_status(rp, frame, paused, status, sizeof(status));
+      ui_set_replay(status);
+      draw_ui(list, selected_index, scroll_offset, &sys_info);
+      needs_redraw = 0;
+    }
+
+    int ch = getch(); // 100ms timeout
+
+    if (ch == 'q')
+      break;
+
+    int last = replay_frame_count(rp) - 1;
+    unsigned long long now_ts = replay_frame_time(rp, frame);
+    int handled = 1;
+    if (ch == ERR || ui_input_captured()) {
+      handled = 0;
+    } else if (ch == ' ') {
+      paused = !paused;
+      clock_gettime(CLOCK_MONOTONIC, &next_step);
+      needs_redraw = 1;
+    } else if (ch == ',' && frame > 0) {
+      frame--;
+    } else if (ch == '.' && frame < last) {
+      frame++;
+    } else if (ch == KEY_LEFT) {
+      frame = replay_find_time(rp, now_ts > 10000 ? now_ts - 10000 : 0);
+    } else if (ch == KEY_RIGHT) {
+      frame = replay_find_time(rp, now_ts + 10000);
+    } else if (ch == KEY_PPAGE) {
+      frame = replay_find_time(rp, now_ts > 300000 ? now_ts - 300000 : 0);
+    } else if (ch == KEY_NPAGE) {
+      frame = replay_find_time(rp, now_ts + 300000);
+    } else if (ch == KEY_HOME) {
+      frame = 0;
+    } else if (ch == KEY_END) {
+      frame = last;
+    } else {
+      handled = 0;
+    }
+
+    if (ch != ERR && !handled) {
+      int action = handle_input(ch, list, &selected_index, &scroll_offset);
+      if (action == ACTION_FILTER) {
+        apply_filter(list);
+        clamp_selection(list, &selected_index, &scroll_offset);
+      }
+      if (action != ACTION_NONE)
+        needs_redraw = 1;
+    }
+
+    // play along at the recorded pace
+    if (!paused && frame < last) {
+      struct timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      if (now.tv_sec > next_step.tv_sec ||
+          (now.tv_sec == next_step.tv_sec && now.tv_nsec >= next_step.tv_nsec)) {
+        long gap = (long)(replay_frame_time(rp, frame + 1) - replay_frame_time(rp, frame));
+        if (gap > 5000)
+          gap = 5000; // the recorder was stopped for a while, don't sit there
+        next_step = now;
+        next_step.tv_sec += gap / 1000;
+        next_step.tv_nsec += (gap % 1000) * 1000000L;
+        if (next_step.tv_nsec >= 1000000000L) {
+          next_step.tv_sec++;
+          next_step.tv_nsec -= 1000000000L;
+        }
+        frame++;
+      }
+    }
+  }
+
+  cleanup_ui();
+  history_free();
+  replay_close(rp);
+  free_process_list(lists[0]);
+  free_process_list(lists[1]);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  int opt;
+  int use_events = 0;
+  int headless = 0;
+  int interval_ms = REFRESH_INTERVAL_MS;
+  const char *record_path = NULL;
+  int smaps_budget_ms = SMAPS_BUDGET_MS;
+  HeadlessOptions batch = {.format = OUTPUT_JSON, .sort_mode = SORT_CPU};
+  while ((opt = getopt(argc, argv, "ec:j:i:m:o:n:s:N:w:r:SPh")) != -1) {
+    switch (opt) {
+    case 'r':
+      return run_replay(optarg);
+    case 'w':
+      record_path = optarg;
+      break;
+    case 'S':
+      ui_show_stats(1);
+      break;
+    case 'P':
+      user_cache_set_watch_passwd(0);
+      break;
+    case 'i':
+      interval_ms = atoi(optarg);
+      if (interval_ms < 10)
+        interval_ms = 10; // don't spin
+      break;
+    case 'm':
+      smaps_budget_ms = atoi(optarg);
+      break;
+    case 'o':
+      headless = 1;
+      if (strcmp(optarg, "csv") == 0) {
+        batch.format = OUTPUT_CSV;
+      } else if (strcmp(optarg, "none") == 0) {
+        batch.format = OUTPUT_NONE;
+      } else if (strcmp(optarg, "json") != 0) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'n':
+      batch.top = atoi(optarg);
+      break;
+    case 's':
+      if (strcmp(optarg, "pid") == 0) {
+        batch.sort_mode = SORT_PID;
+      } else if (strcmp(optarg, "mem") == 0) {
+        batch.sort_mode = SORT_MEM;
+      } else if (strcmp(optarg, "cpu") == 0) {
+        batch.sort_mode = SORT_CPU;
+      } else {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'N':
+      batch.iterations = atol(optarg);
+      break;
+    case 'c':
+      if (strcmp(optarg, "taskstats") == 0) {
+        if (set_collector_backend(BACKEND_TASKSTATS) != 0) {
+          fprintf(stderr, "taskstats unavailable (needs CAP_NET_ADMIN)\n");
+          return 1;
+        }
+      } else if (strcmp(optarg, "procfs") != 0) {
+        usage(argv[0]);
+        return 1;
+      }
+      break;
+    case 'e':
+      use_events = 1;
+      break;
+    case 'j':
+      set_collector_threads(atoi(optarg));
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  Recorder *recorder = NULL;
+  if (record_path) {
+    recorder = recorder_open(record_path, interval_ms);
+    if (!recorder) {
+      perror(record_path);
+      return 1;
+    }
+  }
+
+  // if we can't listen (no permission, old kernel) the System panel just says polling
+  if (use_events)
+    proc_events_start();
+
+  if (headless) {
+    batch.interval_ms = interval_ms;
+    batch.recorder = recorder;
+    int rc = run_headless(&batch);
+    proc_events_stop();
+    recorder_close(recorder);
+    return rc;
+  }
+
+  // only the UI shows PSS/USS/swap, I/O rates and cgroups, headless
+  // output would pay for nothing
+  set_collector_smaps_budget(smaps_budget_ms * 1000);
+  ui_show_smaps(smaps_budget_ms > 0);
+  set_collector_io(1);
+  set_collector_cgroups(1);
+
+  // the sampler thread scans /proc in the background and hands us
+  // finished snapshots - `list` is the one we're showing, sorted and
+  // filtered through its order/visible index arrays. until the first
+  // snapshot lands it's just an empty placeholder
+  Sampler *sampler = sampler_start(interval_ms, recorder);
+  ProcessList *placeholder = create_process_list();
+  ProcessList *list = placeholder;
+
+  if (!sampler || !placeholder) {
+    fprintf(stderr, "Failed to create process list\n");
+    return 1;
+  }
+
+  init_ui();
+  history_init(1024); // grows only if the process count ever outgrows it
 
   int selected_index = 0;
   int scroll_offset = 0;
   int ch;
 
   list->sort_mode = SORT_PID;
-  refresh_process_list(list, NULL);
 
   SystemInfo sys_info = {0};
+  ViewState view;
   int needs_redraw = 1;
+  int want_threads = 0; // the sampler is scanning every thread for us
+  int want_cgroups = 0;  // ... or reading the cgroups' files
 
   // main loop - runs forever until user quits
   while (1) {
+    // pick up a new snapshot if the sampler finished one, never blocks.
+    // the one we're showing goes back to the sampler on acquire, so save
+    // its view settings first
+    save_view(list, selected_index, &view);
+    const Snapshot *snap = sampler_acquire(sampler);
+    if (snap) {
+      list = snap->list;
+      sys_info = snap->sys_info;
+      apply_snapshot(list, &view, &selected_index, &scroll_offset);
+      history_record(list);
+      cgroup_view_update(list);
+      thread_view_set_all(snap->threads);
+      needs_redraw = 1;
+    }
+
+    // every thread on the host and the cgroups' own files are read by the
+    // sampler and come with the snapshots, only while their view is open
+    int all_threads = thread_view_active() && thread_view_pid() == 0;
+    if (all_threads != want_threads) {
+      want_threads = all_threads;
+      sampler_want_threads(sampler, want_threads);
+    }
+    if (cgroup_view_active() != want_cgroups) {
+      want_cgroups = cgroup_view_active();
+      sampler_want_cgroups(sampler, want_cgroups);
+    }
+
+    // one process's threads come from their own thread, faster than the sampler
+    if (thread_view_tick())
+      needs_redraw = 1;
+
     if (needs_redraw) {
-      get_system_info(&sys_info, list, prev_list);
+      want_visible_rows(sampler, list, scroll_offset);
       draw_ui(list, selected_index, scroll_offset, &sys_info);
       needs_redraw = 0;
     }
@@ -48,96 +479,33 @@ int main() {
     } else if (ch != ERR) {
       int action = handle_input(ch, list, &selected_index, &scroll_offset);
 
-      if (action == ACTION_REFRESH) {
-        refresh_process_list(list, prev_list);
-
-        // bounds check
-        if (selected_index >= list->count)
-          selected_index = list->count - 1;
-        if (selected_index < 0)
-          selected_index = 0;
-
+      if (action == ACTION_FILTER) {
+        // filtering only re-walks the snapshot we already have
+        apply_filter(list);
+        clamp_selection(list, &selected_index, &scroll_offset);
         needs_redraw = 1;
 
-      } else if (action == ACTION_REDRAW) {
+      } else if (action == ACTION_REFRESH) {
+        // rescan happens on the sampler thread, we redraw when it lands
+        sampler_request_refresh(sampler);
         needs_redraw = 1;
-      }
-
-    } else {
-      // no input, check if we should auto-refresh
-      static int refresh_counter = 0;
-      refresh_counter++;
-
-      // refresh every ~1 second (10 * 100ms)
-      if (refresh_counter > 10) {
-        pid_t current_pid = -1;
-        if (selected_index < list->count) {
-          current_pid = list->processes[selected_index].pid;
-        }
-
-        // swap the buffers - this is faster than copying
-        ProcessList *temp = prev_list;
-        prev_list = list;
-        list = temp;
-
-        // copy UI state
-        list->sort_mode = prev_list->sort_mode;
-        strcpy(list->filter, prev_list->filter);
-
-        refresh_process_list(list, prev_list);
-
-        // if filter returns nothing, clear it
-        if (list->count == 0 && list->filter[0] != '\0') {
-          list->filter[0] = '\0';
-          reset_search_mode();
-          refresh_process_list(list, prev_list);
-        }
-
-        // try to keep same process selected
-        if (current_pid != -1) {
-          int found = 0;
-
-          for (int i = 0; i < list->count; i++) {
-            if (list->processes[i].pid == current_pid) {
-              selected_index = i;
-              found = 1;
-              break;
-            }
-          }
-
-          if (!found) {
-            if (selected_index >= list->count)
-              selected_index = list->count - 1;
-            if (selected_index < 0)
-              selected_index = 0;
-          }
-
-          // make sure selected item is visible
-          int height, width;
-          getmaxyx(stdscr, height, width);
-          (void)width; // shut up compiler
-
-          int list_height = height - 14;
-          if (list_height < 1)
-            list_height = 1;
-
-          if (selected_index < scroll_offset) {
-            scroll_offset = selected_index;
-          } else if (selected_index >= scroll_offset + list_height) {
-            scroll_offset = selected_index - list_height + 1;
-          }
-        }
 
+      } else if (action == ACTION_REDRAW) {
         needs_redraw = 1;
-        refresh_counter = 0;
       }
     }
   }
 
   // cleanup
   cleanup_ui();
-  free_process_list(list);
-  free_process_list(prev_list);
+  history_free();
+  thread_view_close();
+  cgroup_view_close();
+  sampler_stop(sampler);
+  recorder_close(recorder);
+  proc_events_stop();
+  collector_shutdown();
+  free_process_list(placeholder);
 
   return 0;
 }
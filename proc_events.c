@@ -0,0 +1,420 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+#include "proc_events.h"
+
+// the live PID set is a bitmap indexed by PID - add/remove are O(1) and
+// copying it out walks PIDs in order, like readdir on /proc does.
+// exits go into a ring the sampler drains every tick; if nobody drains
+// it the oldest ones are dropped.
+// the leader's exit event only means the leader thread is done - after
+// pthread_exit() the rest of the process can run on for hours. so it
+// waits in `pending` until a drain sees that the whole thread group is gone
+
+#define EXIT_RING 256
+#define PENDING_EXITS 64
+
+static struct {
+    int sock;
+    pthread_t thread;
+    atomic_int running;
+    atomic_int need_resync;    // set is incomplete until the next /proc scan
+
+    pthread_mutex_t lock;      // guards everything below
+    uint64_t *bits;
+    int pid_max;
+    int count;
+    ProcExit exits[EXIT_RING];
+    unsigned int exit_head;    // next slot to write
+    unsigned int exit_count;   // undrained exits, <= EXIT_RING
+    ProcExit pending[PENDING_EXITS]; // leader exited, oldest first
+    int pending_count;
+} ev = {
+    .sock = -1,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static int read_pid_max(void) {
+    int pid_max = 32768;
+    FILE *f = fopen("/proc/sys/kernel/pid_max", "r");
+    if (f) {
+        if (fscanf(f, "%d", &pid_max) != 1) pid_max = 32768;
+        fclose(f);
+    }
+    return pid_max > 0 ? pid_max : 32768;
+}
+
+// caller holds ev.lock
+static void set_pid(pid_t pid) {
+    if (pid <= 0 || pid >= ev.pid_max) return;
+    uint64_t mask = 1ULL << (pid & 63);
+    if (!(ev.bits[pid >> 6] & mask)) {
+        ev.bits[pid >> 6] |= mask;
+        ev.count++;
+    }
+}
+
+static void clear_pid(pid_t pid) {
+    if (pid <= 0 || pid >= ev.pid_max) return;
+    uint64_t mask = 1ULL << (pid & 63);
+    if (ev.bits[pid >> 6] & mask) {
+        ev.bits[pid >> 6] &= ~mask;
+        ev.count--;
+    }
+}
+
+// /proc/<pid>/stat is still there while the exit event goes out (the
+// parent hasn't reaped it yet), so the final CPU time can be read off it.
+// the mm is already gone though, so RSS is left for the sampler to fill
+// in from the last snapshot
+static void read_exit_stats(ProcExit *e) {
+    char path[64], buf[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", e->pid);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0) return;
+    buf[len] = '\0';
+
+    char *open_paren = strchr(buf, '(');
+    char *close_paren = strrchr(buf, ')');
+    if (!open_paren || !close_paren || close_paren <= open_paren) return;
+
+    size_t name_len = close_paren - open_paren - 1;
+    if (name_len > sizeof(e->name) - 1) name_len = sizeof(e->name) - 1;
+    memcpy(e->name, open_paren + 1, name_len);
+    e->name[name_len] = '\0';
+
+    // fields after the comm, counting state as field 0 (see parse_stat)
+    char *p = close_paren + 2;
+    unsigned long long fields[20] = {0};
+    for (int i = 0; i < 20 && *p; i++) {
+        while (*p && *p != ' ') p++;
+        while (*p == ' ') p++;
+        fields[i] = strtoull(p, NULL, 10); // fields[i] = field i + 1
+    }
+    e->ppid = (pid_t)fields[0];
+    e->cpu_ticks = fields[10] + fields[11]; // utime, stime
+    e->starttime = fields[18];
+}
+
+// caller holds ev.lock. `reused`: the PID already belongs to a new
+// process, which keeps its place in the set
+static void push_exit(const ProcExit *e, int reused) {
+    if (!reused) clear_pid(e->pid);
+    ev.exits[ev.exit_head] = *e;
+    ev.exit_head = (ev.exit_head + 1) % EXIT_RING;
+    if (ev.exit_count < EXIT_RING) ev.exit_count++;
+}
+
+static void record_exit(pid_t pid, int exit_code) {
+    ProcExit e = { .pid = pid, .exit_code = exit_code };
+    read_exit_stats(&e); // outside the lock, it's a syscall or three
+
+    pthread_mutex_lock(&ev.lock);
+    if (e.starttime == 0) {
+        push_exit(&e, 0); // stat is gone already, so is the process
+    } else {
+        if (ev.pending_count == PENDING_EXITS) {
+            // full of leaders whose threads live on, give up on the oldest
+            push_exit(&ev.pending[0], 0);
+            memmove(&ev.pending[0], &ev.pending[1], sizeof(ProcExit) * (PENDING_EXITS - 1));
+            ev.pending_count--;
+        }
+        ev.pending[ev.pending_count++] = e;
+    }
+    pthread_mutex_unlock(&ev.lock);
+}
+
+// 0 = threads of the process are still running, 1 = it's gone (reaped, or
+// only the zombie leader is left in task/ - other threads are released as
+// they exit), 2 = gone and the PID is someone else's now. a zombie gets
+// its final CPU time read again, its threads may have run on for a while
+static int group_gone(ProcExit *e) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/task", e->pid);
+    DIR *dir = opendir(path);
+    if (!dir) return 1;
+    int threads = 0;
+    struct dirent *entry;
+    while (threads < 2 && (entry = readdir(dir))) {
+        if (entry->d_name[0] != '.') threads++;
+    }
+    closedir(dir);
+
+    ProcExit now = { .pid = e->pid };
+    read_exit_stats(&now);
+    if (now.starttime != e->starttime) return 2;
+    if (threads >= 2) return 0;
+    e->cpu_ticks = now.cpu_ticks;
+    return 1;
+}
+
+// moves the pending exits whose process really is gone into the ring.
+// checked outside the lock, the listener may add more in the meantime
+static void confirm_exits(void) {
+    ProcExit check[PENDING_EXITS];
+    pthread_mutex_lock(&ev.lock);
+    int n = ev.pending_count;
+    memcpy(check, ev.pending, sizeof(ProcExit) * n);
+    pthread_mutex_unlock(&ev.lock);
+
+    int gone[PENDING_EXITS];
+    int any = 0;
+    for (int i = 0; i < n; i++) {
+        gone[i] = group_gone(&check[i]);
+        any |= gone[i];
+    }
+    if (!any) return;
+
+    pthread_mutex_lock(&ev.lock);
+    for (int i = 0; i < n; i++) {
+        if (!gone[i]) continue;
+        for (int k = 0; k < ev.pending_count; k++) {
+            if (ev.pending[k].pid != check[i].pid || ev.pending[k].starttime != check[i].starttime) continue;
+            push_exit(&check[i], gone[i] == 2);
+            memmove(&ev.pending[k], &ev.pending[k + 1], sizeof(ProcExit) * (ev.pending_count - k - 1));
+            ev.pending_count--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&ev.lock);
+}
+
+static void handle_event(const struct proc_event *pe) {
+    switch (pe->what) {
+    case PROC_EVENT_FORK:
+        // threads come through here too, only new thread groups are processes
+        if (pe->event_data.fork.child_pid != pe->event_data.fork.child_tgid) break;
+        pthread_mutex_lock(&ev.lock);
+        set_pid(pe->event_data.fork.child_tgid);
+        pthread_mutex_unlock(&ev.lock);
+        break;
+    case PROC_EVENT_EXEC:
+        // exec can come after a missed fork (e.g. right after a resync)
+        pthread_mutex_lock(&ev.lock);
+        set_pid(pe->event_data.exec.process_tgid);
+        pthread_mutex_unlock(&ev.lock);
+        break;
+    case PROC_EVENT_EXIT:
+        if (pe->event_data.exit.process_pid != pe->event_data.exit.process_tgid) {
+            // a thread. if the leader is already gone, its exit code is the process's so far
+            pthread_mutex_lock(&ev.lock);
+            for (int i = 0; i < ev.pending_count; i++) {
+                if (ev.pending[i].pid == pe->event_data.exit.process_tgid) {
+                    ev.pending[i].exit_code = (int)pe->event_data.exit.exit_code;
+                }
+            }
+            pthread_mutex_unlock(&ev.lock);
+            break;
+        }
+        // the leader's - the process may live on without it, confirm_exits() checks later
+        record_exit(pe->event_data.exit.process_tgid, (int)pe->event_data.exit.exit_code);
+        break;
+    default:
+        break;
+    }
+}
+
+static void* listener_thread(void *arg) {
+    (void)arg;
+    char buf[8192] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+    while (atomic_load(&ev.running)) {
+        // wake up now and then to notice proc_events_stop()
+        struct pollfd pfd = { .fd = ev.sock, .events = POLLIN };
+        if (poll(&pfd, 1, 250) <= 0) continue;
+
+        ssize_t len = recv(ev.sock, buf, sizeof(buf), 0);
+        if (len < 0) {
+            // the kernel dropped events on us, have the next refresh rescan /proc
+            if (errno == ENOBUFS) atomic_store(&ev.need_resync, 1);
+            continue;
+        }
+
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, (size_t)len);
+             nlh = NLMSG_NEXT(nlh, len)) {
+            if (nlh->nlmsg_type == NLMSG_ERROR || nlh->nlmsg_type == NLMSG_NOOP) continue;
+            struct cn_msg *msg = NLMSG_DATA(nlh);
+            if (msg->id.idx != CN_IDX_PROC || msg->id.val != CN_VAL_PROC) continue;
+            handle_event((const struct proc_event *)msg->data);
+        }
+    }
+    return NULL;
+}
+
+static int subscribe(int sock, enum proc_cn_mcast_op op) {
+    struct {
+        struct nlmsghdr hdr;
+        struct __attribute__((packed)) {
+            struct cn_msg msg;
+            enum proc_cn_mcast_op op;
+        } body;
+    } req;
+
+    memset(&req, 0, sizeof(req));
+    req.hdr.nlmsg_len = sizeof(req);
+    req.hdr.nlmsg_type = NLMSG_DONE;
+    req.hdr.nlmsg_pid = getpid();
+    req.body.msg.id.idx = CN_IDX_PROC;
+    req.body.msg.id.val = CN_VAL_PROC;
+    req.body.msg.len = sizeof(enum proc_cn_mcast_op);
+    req.body.op = op;
+
+    return send(sock, &req, sizeof(req), 0) == (ssize_t)sizeof(req) ? 0 : -1;
+}
+
+// starts listening, returns -1 (and leaves polling in charge) if the
+// connector isn't there or we aren't allowed to use it.
+// the set starts empty - the first refresh fills it from a /proc scan
+int proc_events_start(void) {
+    if (atomic_load(&ev.running)) return 0;
+
+    int sock = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (sock < 0) return -1;
+
+    struct sockaddr_nl addr = {
+        .nl_family = AF_NETLINK,
+        .nl_groups = CN_IDX_PROC,
+        .nl_pid = 0,
+    };
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        subscribe(sock, PROC_CN_MCAST_LISTEN) != 0) {
+        close(sock);
+        return -1;
+    }
+
+    // a big receive buffer rides out fork storms without ENOBUFS
+    int rcvbuf = 4 * 1024 * 1024;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    pthread_mutex_lock(&ev.lock);
+    ev.pid_max = read_pid_max();
+    ev.bits = calloc((ev.pid_max + 63) / 64, sizeof(uint64_t));
+    ev.count = 0;
+    ev.exit_head = 0;
+    ev.exit_count = 0;
+    ev.pending_count = 0;
+    pthread_mutex_unlock(&ev.lock);
+    if (!ev.bits) {
+        close(sock);
+        return -1;
+    }
+
+    ev.sock = sock;
+    atomic_store(&ev.running, 1);
+    if (pthread_create(&ev.thread, NULL, listener_thread, NULL) != 0) {
+        atomic_store(&ev.running, 0);
+        close(sock);
+        ev.sock = -1;
+        free(ev.bits);
+        ev.bits = NULL;
+        return -1;
+    }
+    atomic_store(&ev.need_resync, 1);
+    return 0;
+}
+
+void proc_events_stop(void) {
+    if (!atomic_load(&ev.running)) return;
+
+    atomic_store(&ev.running, 0);
+    pthread_join(ev.thread, NULL);
+
+    subscribe(ev.sock, PROC_CN_MCAST_IGNORE);
+    close(ev.sock);
+    ev.sock = -1;
+
+    pthread_mutex_lock(&ev.lock);
+    free(ev.bits);
+    ev.bits = NULL;
+    ev.count = 0;
+    pthread_mutex_unlock(&ev.lock);
+}
+
+int proc_events_active(void) {
+    return atomic_load(&ev.running);
+}
+
+// copies the live PID set into *pids (growing it as needed), returns the
+// count or -1 if the caller has to scan /proc instead - events aren't
+// running, or some were lost and the set needs a resync. the flag is taken
+// here, before the scan, so a drop while scanning asks for another one
+int proc_events_pids(pid_t **pids, int *capacity) {
+    if (!proc_events_active() || atomic_exchange(&ev.need_resync, 0)) return -1;
+
+    pthread_mutex_lock(&ev.lock);
+    if (ev.count > *capacity) {
+        pid_t *new_ptr = realloc(*pids, sizeof(pid_t) * ev.count);
+        if (!new_ptr) {
+            pthread_mutex_unlock(&ev.lock);
+            return -1;
+        }
+        *pids = new_ptr;
+        *capacity = ev.count;
+    }
+
+    int n = 0;
+    int words = (ev.pid_max + 63) / 64;
+    for (int w = 0; w < words; w++) {
+        uint64_t bits = ev.bits[w];
+        while (bits) {
+            int bit = __builtin_ctzll(bits);
+            (*pids)[n++] = (pid_t)(w * 64 + bit);
+            bits &= bits - 1;
+        }
+    }
+    pthread_mutex_unlock(&ev.lock);
+    return n;
+}
+
+// merges PIDs found by a /proc scan into the set (periodic resync).
+// a union never loses a fork that raced the scan; PIDs that are really
+// gone get dropped with proc_events_forget() when reading them fails
+void proc_events_add(const pid_t *pids, int count) {
+    if (!proc_events_active()) return;
+
+    pthread_mutex_lock(&ev.lock);
+    for (int i = 0; i < count; i++) set_pid(pids[i]);
+    pthread_mutex_unlock(&ev.lock);
+}
+
+void proc_events_forget(pid_t pid) {
+    if (!proc_events_active()) return;
+
+    pthread_mutex_lock(&ev.lock);
+    clear_pid(pid);
+    pthread_mutex_unlock(&ev.lock);
+}
+
+// moves up to max recorded exits (oldest first) into out, returns how many.
+// exits only show up once the whole process is gone, see confirm_exits()
+int proc_events_exits(ProcExit *out, int max) {
+    if (!proc_events_active()) return 0;
+
+    confirm_exits();
+    pthread_mutex_lock(&ev.lock);
+    int n = 0;
+    while (ev.exit_count > 0 && n < max) {
+        unsigned int tail = (ev.exit_head + EXIT_RING - ev.exit_count) % EXIT_RING;
+        out[n++] = ev.exits[tail];
+        ev.exit_count--;
+    }
+    pthread_mutex_unlock(&ev.lock);
+    return n;
+}
@@ -0,0 +1,33 @@
+#ifndef PROC_EVENTS_H
+#define PROC_EVENTS_H
+
+#include <sys/types.h>
+
+// optional event-driven PID tracking through the kernel proc connector
+// (NETLINK_CONNECTOR). a listener thread keeps the set of live PIDs current
+// from fork/exit events, so a refresh doesn't need to readdir /proc, and it
+// catches processes too short-lived for any poll to see.
+// needs CAP_NET_ADMIN - without it proc_events_start() fails and the
+// collector just keeps scanning /proc.
+
+// a process that exited, with what it had used by then
+typedef struct {
+    pid_t pid;
+    pid_t ppid;
+    char name[16];
+    int exit_code;                // raw wait status
+    unsigned long long cpu_ticks; // utime + stime, clock ticks
+    unsigned long long starttime;
+    unsigned long rss_kb;         // last RSS seen, 0 if it never got sampled
+} ProcExit;
+
+int proc_events_start(void);
+void proc_events_stop(void);
+int proc_events_active(void);
+
+int proc_events_pids(pid_t **pids, int *capacity);
+void proc_events_add(const pid_t *pids, int count);
+void proc_events_forget(pid_t pid);
+int proc_events_exits(ProcExit *out, int max);
+
+#endif
@@ -3,38 +3,201 @@
 #include <stdlib.h>
 #include <string.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <ctype.h>
 #include <unistd.h>
-#include <pwd.h>
 #include <sys/stat.h>
 #include <sys/utsname.h>
 #include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
 #include "process_list.h"
+#include "cpu_stats.h"
+#include "proc_events.h"
+#include "process_tree.h"
+#include "sort.h"
+#include "taskstats.h"
+#include "user_cache.h"
 
 ProcessList* create_process_list() {
     ProcessList *list = calloc(1, sizeof(ProcessList));
     if (!list) return NULL;
     
-    list->capacity = 128; // should be enough for most cases
     list->count = 0;
-    
-    list->processes = malloc(sizeof(ProcessInfo) * list->capacity);
-    if (!list->processes) {
-        free(list);
+    if (reserve_process_list(list, 128) != 0) { // should be enough for most cases
+        free_process_list(list);
         return NULL;
     }
     
     list->filter[0] = '\0';
+    list->incremental = 1;
     return list;
 }
 
+static void free_columns(ProcessList *list) {
+    free(list->pid);
+    free(list->uid);
+    free(list->ppid);
+    free(list->utime);
+    free(list->stime);
+    free(list->starttime);
+    free(list->memory_sq);
+    free(list->cpu_usage);
+    free(list->threads);
+    free(list->priority);
+    free(list->nice);
+    free(list->state);
+    free(list->rss_peak);
+    free(list->cpu_delay);
+    free(list->io_delay);
+    free(list->enriched);
+    free(list->pss);
+    free(list->uss);
+    free(list->swap);
+    free(list->smaps_ms);
+    free(list->smaps_status);
+    free(list->io_read);
+    free(list->io_write);
+    free(list->io_syscr);
+    free(list->io_syscw);
+    free(list->io_read_rate);
+    free(list->io_write_rate);
+    free(list->io_syscr_rate);
+    free(list->io_syscw_rate);
+    free(list->io_status);
+    free(list->name);
+    free(list->user);
+    free(list->command);
+    free(list->cgroup);
+}
+
 void free_process_list(ProcessList *list) {
     if (list) {
-        free(list->processes);
+        free(list->visible);
+        free(list->order);
+        free(list->sort_keys);
+        free(list->pid_index);
+        free(list->tree_parent);
+        free(list->tree_depth);
+        free(list->tree_size);
+        free(list->tree_cpu);
+        free(list->tree_mem);
+        free(list->tree_flags);
+        free(list->tree_guides);
+        free(list->tree_scratch);
+        free(list->cgroup_stats);
+        free_columns(list);
+        arena_free(&list->text);
+        cpu_stats_free(&list->cpu);
         free(list);
     }
 }
 
+#define GROW_COLUMN(col, n) do { \
+        void *p_ = realloc((col), sizeof(*(col)) * (n)); \
+        if (!p_) return -1; \
+        (col) = p_; \
+    } while (0)
+
+// makes room for at least n rows in every column
+int reserve_process_list(ProcessList *list, int n) {
+    if (n <= list->capacity) return 0;
+
+    GROW_COLUMN(list->pid, n);
+    GROW_COLUMN(list->uid, n);
+    GROW_COLUMN(list->ppid, n);
+    GROW_COLUMN(list->utime, n);
+    GROW_COLUMN(list->stime, n);
+    GROW_COLUMN(list->starttime, n);
+    GROW_COLUMN(list->memory_sq, n);
+    GROW_COLUMN(list->cpu_usage, n);
+    GROW_COLUMN(list->threads, n);
+    GROW_COLUMN(list->priority, n);
+    GROW_COLUMN(list->nice, n);
+    GROW_COLUMN(list->state, n);
+    GROW_COLUMN(list->rss_peak, n);
+    GROW_COLUMN(list->cpu_delay, n);
+    GROW_COLUMN(list->io_delay, n);
+    GROW_COLUMN(list->enriched, n);
+    GROW_COLUMN(list->pss, n);
+    GROW_COLUMN(list->uss, n);
+    GROW_COLUMN(list->swap, n);
+    GROW_COLUMN(list->smaps_ms, n);
+    GROW_COLUMN(list->smaps_status, n);
+    GROW_COLUMN(list->io_read, n);
+    GROW_COLUMN(list->io_write, n);
+    GROW_COLUMN(list->io_syscr, n);
+    GROW_COLUMN(list->io_syscw, n);
+    GROW_COLUMN(list->io_read_rate, n);
+    GROW_COLUMN(list->io_write_rate, n);
+    GROW_COLUMN(list->io_syscr_rate, n);
+    GROW_COLUMN(list->io_syscw_rate, n);
+    GROW_COLUMN(list->io_status, n);
+    GROW_COLUMN(list->name, n);
+    GROW_COLUMN(list->user, n);
+    GROW_COLUMN(list->command, n);
+    GROW_COLUMN(list->cgroup, n);
+
+    list->capacity = n;
+    return 0;
+}
+
+static const char* state_name(char state) {
+    // map state char to readable name
+    switch (state) {
+        case 'R': return "Running";
+        case 'S': return "Sleeping";
+        case 'D': return "Disk Sleep";
+        case 'Z': return "Zombie";
+        case 'T': return "Stopped";
+        case 't': return "Tracing";
+        case 'X': return "Dead";
+        case 'x': return "Dead";
+        case 'K': return "Wakekill";
+        case 'W': return "Waking";
+        case 'P': return "Parked";
+        case 'I': return "Idle";
+        default:  return "Unknown";
+    }
+}
+
+// gathers row idx of the columns into one ProcessInfo for display code
+ProcessInfo* get_process(const ProcessList *list, int idx, ProcessInfo *out) {
+    out->pid = list->pid[idx];
+    out->uid = list->uid[idx];
+    out->name = arena_str(&list->text, list->name[idx]);
+    out->user = arena_str(&list->text, list->user[idx]);
+    out->command = arena_str(&list->text, list->command[idx]);
+    out->cgroup = arena_str(&list->text, list->cgroup[idx]);
+    out->state = list->state[idx];
+    out->memory_sq = list->memory_sq[idx];
+    out->cpu_usage = list->cpu_usage[idx];
+    out->utime = list->utime[idx];
+    out->stime = list->stime[idx];
+    out->starttime = list->starttime[idx];
+    out->ppid = list->ppid[idx];
+    out->threads = list->threads[idx];
+    out->priority = list->priority[idx];
+    out->nice = list->nice[idx];
+    out->status_name = state_name(list->state[idx]);
+    out->rss_peak = list->rss_peak[idx];
+    out->cpu_delay = list->cpu_delay[idx];
+    out->io_delay = list->io_delay[idx];
+    out->pss = list->pss[idx];
+    out->uss = list->uss[idx];
+    out->swap = list->swap[idx];
+    out->smaps_status = list->smaps_status[idx];
+    out->smaps_ms = list->smaps_ms[idx];
+    out->io_read_rate = list->io_read_rate[idx];
+    out->io_write_rate = list->io_write_rate[idx];
+    out->io_syscr_rate = list->io_syscr_rate[idx];
+    out->io_syscw_rate = list->io_syscw_rate[idx];
+    out->io_status = list->io_status[idx];
+    return out;
+}
+
 // check if string is all digits (for PID detection)
 static int is_numeric(const char *str) {
     while (*str) {
@@ -44,101 +207,312 @@ static int is_numeric(const char *str) {
     return 1;
 }
 
-// read VmRSS from /proc/[pid]/status
-static long unsigned int get_memory_usage(const char *pid_str) {
-    char path[256];
-    snprintf(path, sizeof(path), "/proc/%s/status", pid_str);
-    
-    FILE *f = fopen(path, "r");
-    if (!f) return 0; // process probably died
+// matches the filter against command, user and PID - empty filter matches all
+static int process_matches_filter(const ProcessList *list, int idx, const char *filter) {
+    if (filter[0] == '\0') return 1;
 
-    char line[256];
-    long unsigned int mem = 0;
-    
-    while (fgets(line, sizeof(line), f)) {
-        if (strncmp(line, "VmRSS:", 6) == 0) {
-            sscanf(line, "VmRSS: %lu", &mem);
-            break;
+    char pid_str[32];
+    snprintf(pid_str, 32, "%d", list->pid[idx]);
+
+    return strcasestr(arena_str(&list->text, list->command[idx]), filter) ||
+           strcasestr(arena_str(&list->text, list->user[idx]), filter) ||
+           strstr(pid_str, filter);
+}
+
+// rebuilds list->visible from the current order and filter - no /proc access,
+// so it's cheap enough to run on every search keystroke
+void apply_filter(ProcessList *list) {
+    if (list->count > list->visible_capacity) {
+        int *new_ptr = realloc(list->visible, sizeof(int) * list->count);
+        if (!new_ptr) {
+            list->visible_count = 0;
+            return;
         }
+        list->visible = new_ptr;
+        list->visible_capacity = list->count;
     }
-    fclose(f);
-    return mem;
-}
 
-static void get_user_name(uid_t uid, char *buffer, size_t size) {
-    struct passwd *pw = getpwuid(uid);
-    if (pw) {
-        strncpy(buffer, pw->pw_name, size - 1);
-        buffer[size - 1] = '\0';
-    } else {
-        snprintf(buffer, size, "%d", uid); // fallback to UID
+    // without a current sort order the view is just snapshot order
+    int sorted = list->order && list->order_count == list->count;
+
+    if (list->tree_mode && sorted) {
+        // the tree keeps the ancestors of every match, so it's worked out there
+        for (int i = 0; i < list->count; i++) {
+            list->tree_flags[i] &= TREE_COLLAPSED;
+            if (process_matches_filter(list, i, list->filter)) list->tree_flags[i] |= TREE_MATCH;
+        }
+        filter_process_tree(list);
+        return;
     }
-}
 
-// comparators for qsort
-static int compare_pid(const void *a, const void *b) {
-    return ((ProcessInfo*)a)->pid - ((ProcessInfo*)b)->pid;
+    list->visible_count = 0;
+    for (int i = 0; i < list->count; i++) {
+        int idx = sorted ? list->order[i] : i;
+        if (process_matches_filter(list, idx, list->filter)) {
+            list->visible[list->visible_count++] = idx;
+        }
+    }
 }
 
-static int compare_mem(const void *a, const void *b) {
-    long diff = ((ProcessInfo*)b)->memory_sq - ((ProcessInfo*)a)->memory_sq;
-    if (diff > 0) return 1;
-    if (diff < 0) return -1;
-    return 0;
-}
+// row of pid in the filtered view, or -1 if it's filtered out / gone
+int find_visible_row(const ProcessList *list, pid_t pid) {
+    int idx = find_process(list, pid);
+    if (idx < 0) return -1;
 
-static int compare_cpu(const void *a, const void *b) {
-    float diff = ((ProcessInfo*)b)->cpu_usage - ((ProcessInfo*)a)->cpu_usage;
-    if (diff > 0) return 1;
-    if (diff < 0) return -1;
-    return 0;
+    for (int row = 0; row < list->visible_count; row++) {
+        if (list->visible[row] == idx) return row;
+    }
+    return -1;
 }
 
+// builds list->order (a permutation of the rows) for the current sort mode.
+// the snapshot itself is never reordered: only (key, index) pairs get sorted,
+// with radix sort, and the renderer walks the permutation
 void sort_process_list(ProcessList *list) {
-    if (!list || list->count == 0) return;
-    
+    if (!list) return;
+
+    if (list->count > list->order_capacity) {
+        int *new_order = realloc(list->order, sizeof(int) * list->count);
+        SortKey *new_keys = realloc(list->sort_keys, sizeof(SortKey) * list->count * 2);
+        if (new_order) list->order = new_order;
+        if (new_keys) list->sort_keys = new_keys;
+        if (!new_order || !new_keys) {
+            list->order_count = 0; // fall back to snapshot order
+            apply_filter(list);
+            return;
+        }
+        list->order_capacity = list->count;
+    }
+
+    SortKey *keys = list->sort_keys;
+    // one tight loop per mode, each reading a single column.
+    // MEM and CPU sort descending, so their keys are inverted
     switch (list->sort_mode) {
         case SORT_MEM:
-            qsort(list->processes, list->count, sizeof(ProcessInfo), compare_mem);
+            for (int i = 0; i < list->count; i++) keys[i].key = ~(unsigned long long)list->memory_sq[i];
             break;
         case SORT_CPU:
-            qsort(list->processes, list->count, sizeof(ProcessInfo), compare_cpu);
+            for (int i = 0; i < list->count; i++) keys[i].key = ~float_sort_key(list->cpu_usage[i]) & 0xffffffffull;
+            break;
+        case SORT_PSS:
+            // rows that haven't been read yet go to the bottom
+            for (int i = 0; i < list->count; i++) {
+                keys[i].key = ~(unsigned long long)(list->smaps_status[i] == SMAPS_OK ? list->pss[i] : 0);
+            }
+            break;
+        case SORT_IO:
+            for (int i = 0; i < list->count; i++) {
+                keys[i].key = ~float_sort_key(list->io_read_rate[i] + list->io_write_rate[i]) & 0xffffffffull;
+            }
             break;
         case SORT_PID:
         default:
-            qsort(list->processes, list->count, sizeof(ProcessInfo), compare_pid);
+            for (int i = 0; i < list->count; i++) keys[i].key = (unsigned long long)list->pid[i];
             break;
     }
+    for (int i = 0; i < list->count; i++) keys[i].index = i;
+
+    radix_sort_keys(keys, keys + list->count, list->count);
+
+    for (int i = 0; i < list->count; i++) list->order[i] = keys[i].index;
+    list->order_count = list->count;
+
+    // tree view re-walks that order parent by parent
+    if (list->tree_mode) build_process_tree(list);
+
+    // the filtered view is built on top of the order
+    apply_filter(list);
 }
 
-// reads the "cpu" line from /proc/stat
-static void get_system_cpu_times(unsigned long long *total, unsigned long long *idle_out) {
-    FILE *f = fopen("/proc/stat", "r");
-    if (!f) return;
-    
-    char line[256];
-    if (fgets(line, sizeof(line), f)) {
-        unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
-        if (strncmp(line, "cpu ", 4) == 0) {
-            sscanf(line, "cpu  %llu %llu %llu %llu %llu %llu %llu %llu", 
-                   &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal);
-            
-            *idle_out = idle + iowait;
-            *total = user + nice + system + idle + iowait + irq + softirq + steal;
+static unsigned int hash_pid(pid_t pid) {
+    return (unsigned int)pid * 2654435761u; // knuth multiplicative hash
+}
+
+// (re)builds the PID index - keeps load factor under 50% so probes stay short
+void build_pid_index(ProcessList *list) {
+    int size = list->pid_index_size ? list->pid_index_size : 256;
+    while (size < list->count * 2) size *= 2;
+
+    if (size != list->pid_index_size) {
+        int *new_index = realloc(list->pid_index, sizeof(int) * size);
+        if (!new_index) {
+            // no index is better than a wrong one, find_process falls back to a scan
+            free(list->pid_index);
+            list->pid_index = NULL;
+            list->pid_index_size = 0;
+            return;
+        }
+        list->pid_index = new_index;
+        list->pid_index_size = size;
+    }
+
+    memset(list->pid_index, 0xff, sizeof(int) * size); // all -1
+    unsigned int mask = (unsigned int)size - 1;
+
+    for (int i = 0; i < list->count; i++) {
+        unsigned int slot = hash_pid(list->pid[i]) & mask;
+        while (list->pid_index[slot] != -1) slot = (slot + 1) & mask;
+        list->pid_index[slot] = i;
+    }
+}
+
+// returns the row of pid in list, or -1 if it's not there
+int find_process(const ProcessList *list, pid_t pid) {
+    if (!list) return -1;
+
+    if (!list->pid_index) {
+        for (int i = 0; i < list->count; i++) {
+            if (list->pid[i] == pid) return i;
+        }
+        return -1;
+    }
+
+    unsigned int mask = (unsigned int)list->pid_index_size - 1;
+    unsigned int slot = hash_pid(pid) & mask;
+    while (list->pid_index[slot] != -1) {
+        int idx = list->pid_index[slot];
+        if (list->pid[idx] == pid) return idx;
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+// system-wide files, opened once and re-read with pread() every refresh.
+// which thermal zone and battery to read is worked out on the first
+// refresh (and after system_info_rescan()), as are hostname and kernel
+typedef struct {
+    int meminfo;
+    int uptime;
+    int loadavg;
+    int diskstats;
+    int cpu_temp;      // temp of the chosen thermal zone, -1 = none
+    int bat_temp;      // BAT0 or BAT1 temp, -1 = none
+    char hostname[64];
+    char kernel[64];
+} SysFiles;
+
+static SysFiles sys_files = { -1, -1, -1, -1, -1, -1, "", "" };
+static int sys_files_ready = 0;        // sampler thread only
+static atomic_int sys_rescan_requested;
+
+static void close_fd(int *fd) {
+    if (*fd >= 0) close(*fd);
+    *fd = -1;
+}
+
+// thermal zone to show as "CPU Temp", in order of preference
+static int find_cpu_temp_zone(void) {
+    const char *priority_names[] = {"x86_pkg_temp", "TCPU", "INT3400 Thermal", "acpitz", "SEN1", NULL};
+    char types[10][64] = {{0}};
+
+    // read each zone's type once, then match against the preference list
+    for (int i = 0; i < 10; i++) {
+        char type_path[64];
+        snprintf(type_path, sizeof(type_path), "/sys/class/thermal/thermal_zone%d/type", i);
+        FILE *f_type = fopen(type_path, "r");
+        if (!f_type) continue;
+        if (fgets(types[i], sizeof(types[i]), f_type)) types[i][strcspn(types[i], "\n")] = 0;
+        fclose(f_type);
+    }
+
+    for (int p = 0; priority_names[p] != NULL; p++) {
+        for (int i = 0; i < 10; i++) {
+            if (strcasecmp(types[i], priority_names[p]) == 0) return i;
         }
     }
-    fclose(f);
+    return 0; // fallback to zone0
+}
+
+static void discover_sys_files(void) {
+    SysFiles *sf = &sys_files;
+
+    // kept open across rescans, these never move
+    if (sf->meminfo < 0) sf->meminfo = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+    if (sf->uptime < 0) sf->uptime = open("/proc/uptime", O_RDONLY | O_CLOEXEC);
+    if (sf->loadavg < 0) sf->loadavg = open("/proc/loadavg", O_RDONLY | O_CLOEXEC);
+    if (sf->diskstats < 0) sf->diskstats = open("/proc/diskstats", O_RDONLY | O_CLOEXEC);
+
+    // sensors can come and go (a battery gets plugged in, a module loads)
+    close_fd(&sf->cpu_temp);
+    close_fd(&sf->bat_temp);
+
+    char temp_path[64];
+    snprintf(temp_path, sizeof(temp_path), "/sys/class/thermal/thermal_zone%d/temp", find_cpu_temp_zone());
+    sf->cpu_temp = open(temp_path, O_RDONLY | O_CLOEXEC);
+
+    sf->bat_temp = open("/sys/class/power_supply/BAT0/temp", O_RDONLY | O_CLOEXEC);
+    if (sf->bat_temp < 0) sf->bat_temp = open("/sys/class/power_supply/BAT1/temp", O_RDONLY | O_CLOEXEC);
+
+    gethostname(sf->hostname, sizeof(sf->hostname));
+    sf->hostname[sizeof(sf->hostname) - 1] = '\0';
+
+    struct utsname buffer;
+    if (uname(&buffer) == 0) {
+        snprintf(sf->kernel, sizeof(sf->kernel), "%.63s", buffer.release);
+    }
+}
+
+// re-resolve sensors and hostname/kernel on the next refresh, safe from any thread
+void system_info_rescan(void) {
+    atomic_store(&sys_rescan_requested, 1);
+}
+
+static void ensure_sys_files(void) {
+    if (!sys_files_ready || atomic_exchange(&sys_rescan_requested, 0)) {
+        discover_sys_files();
+        sys_files_ready = 1;
+    }
+}
+
+// whole file from offset 0 into buf (NUL terminated), -1 if fd isn't open.
+// /proc files hand out their contents in chunks, so keep going until EOF
+static ssize_t pread_file(int fd, char *buf, size_t size) {
+    if (fd < 0) return -1;
+    size_t used = 0;
+    while (used < size - 1) {
+        ssize_t n = pread(fd, buf + used, size - 1 - used, used);
+        if (n < 0) return -1;
+        if (n == 0) break;
+        used += n;
+    }
+    buf[used] = '\0';
+    return used;
+}
+
+static int pread_long(int fd, long *out) {
+    char buf[32];
+    if (pread_file(fd, buf, sizeof(buf)) <= 0) return -1;
+    *out = strtol(buf, NULL, 10);
+    return 0;
+}
+
+// splits buf into lines in place, returns the next one or NULL
+static char* next_line(char **cursor) {
+    char *line = *cursor;
+    if (!line || *line == '\0') return NULL;
+    char *nl = strchr(line, '\n');
+    if (nl) {
+        *nl = '\0';
+        *cursor = nl + 1;
+    } else {
+        *cursor = NULL;
+    }
+    return line;
 }
 
 void get_system_info(SystemInfo *info, ProcessList *list, ProcessList *prev_list) {
+    ensure_sys_files();
+
+    // big enough for /proc/diskstats on a box with lots of devices, sampler thread only
+    static char buf[65536];
+
     // Memory info
-    FILE *f = fopen("/proc/meminfo", "r");
-    if (f) {
-        char line[256];
+    if (pread_file(sys_files.meminfo, buf, sizeof(buf)) > 0) {
+        char *cursor = buf, *line;
         unsigned long mem_total = 0, mem_free = 0, buffers = 0, cached = 0, srecl = 0;
         unsigned long mem_avail = 0, swap_total = 0, swap_free = 0;
         
-        while (fgets(line, sizeof(line), f)) {
+        while ((line = next_line(&cursor))) {
             if (sscanf(line, "MemTotal: %lu kB", &mem_total) == 1) continue;
             if (sscanf(line, "MemFree: %lu kB", &mem_free) == 1) continue;
             if (sscanf(line, "MemAvailable: %lu kB", &mem_avail) == 1) continue;
@@ -148,7 +522,6 @@ void get_system_info(SystemInfo *info, ProcessList *list, ProcessList *prev_list
             if (sscanf(line, "SwapTotal: %lu kB", &swap_total) == 1) continue;
             if (sscanf(line, "SwapFree: %lu kB", &swap_free) == 1) continue;
         }
-        fclose(f);
         info->mem_total = mem_total;
         info->mem_free = mem_free;
         info->mem_available = mem_avail;
@@ -158,43 +531,43 @@ void get_system_info(SystemInfo *info, ProcessList *list, ProcessList *prev_list
         info->mem_used = mem_total - mem_free - buffers - cached - srecl;
     }
 
-    // CPU percentage (delta calculation)
-    if (prev_list && list->total_cpu_time > prev_list->total_cpu_time) {
-        unsigned long long total_diff = list->total_cpu_time - prev_list->total_cpu_time;
-        unsigned long long idle_diff = list->total_cpu_idle - prev_list->total_cpu_idle;
-        unsigned long long used_diff = total_diff - idle_diff;
-        info->cpu_percent = (float)used_diff / total_diff * 100.0f;
-    } else {
-        info->cpu_percent = 0.0f;
+    // CPU percentage (delta calculation) - /proc/stat was read by refresh_process_list()
+    const CpuTimes *now = &list->cpu.total;
+    const CpuTimes *old = prev_list ? &prev_list->cpu.total : NULL;
+    info->cpu_percent = 0.0f;
+    if (old && cpu_times_total(now) > cpu_times_total(old)) {
+        unsigned long long total_diff = cpu_times_total(now) - cpu_times_total(old);
+        unsigned long long idle_diff = cpu_times_idle(now) - cpu_times_idle(old);
+        if (idle_diff <= total_diff) {
+            info->cpu_percent = (float)(total_diff - idle_diff) / total_diff * 100.0f;
+        }
+        // where the rest went on a VM: stolen by the hypervisor, or spent running our own guests
+        info->cpu_steal = (float)(now->steal - old->steal) / total_diff * 100.0f;
+        info->cpu_guest = (float)((now->guest + now->guest_nice) - (old->guest + old->guest_nice)) / total_diff * 100.0f;
     }
 
     // Uptime
-    FILE *fu = fopen("/proc/uptime", "r");
-    if (fu) {
+    if (pread_file(sys_files.uptime, buf, sizeof(buf)) > 0) {
         double uptime_sec;
-        if (fscanf(fu, "%lf", &uptime_sec) == 1) {
+        if (sscanf(buf, "%lf", &uptime_sec) == 1) {
             info->uptime = uptime_sec;
         }
-        fclose(fu);
     }
 
-    gethostname(info->hostname, sizeof(info->hostname));
+    // looked up once, see system_info_rescan()
+    memcpy(info->hostname, sys_files.hostname, sizeof(info->hostname));
+    memcpy(info->kernel, sys_files.kernel, sizeof(info->kernel));
 
-    // Kernel version
-    struct utsname buffer;
-    if (uname(&buffer) == 0) {
-        strncpy(info->kernel, buffer.release, sizeof(info->kernel) - 1);
-        info->kernel[sizeof(info->kernel) - 1] = '\0';
+    // what getloadavg() reads, minus its open/close
+    if (pread_file(sys_files.loadavg, buf, sizeof(buf)) > 0) {
+        sscanf(buf, "%lf %lf %lf", &info->load_avg[0], &info->load_avg[1], &info->load_avg[2]);
     }
 
-    getloadavg(info->load_avg, 3);
-
     // Disk I/O - this was a pain to figure out
-    FILE *fd = fopen("/proc/diskstats", "r");
     unsigned long long current_read = 0, current_write = 0;
-    if (fd) {
-        char line[512];
-        while (fgets(line, sizeof(line), fd)) {
+    if (pread_file(sys_files.diskstats, buf, sizeof(buf)) > 0) {
+        char *cursor = buf, *line;
+        while ((line = next_line(&cursor))) {
             int major, minor;
             char dev_name[32];
             unsigned long long r_completed, r_merged, r_sectors, w_completed, w_merged, w_sectors;
@@ -216,317 +589,1124 @@ void get_system_info(SystemInfo *info, ProcessList *list, ProcessList *prev_list
                 }
             }
         }
-        fclose(fd);
     }
     
     // calculate rates (sectors are 512 bytes)
-    if (list->old_disk_read_sectors > 0) {
-        if (current_read >= list->old_disk_read_sectors)
-             info->disk_read_rate = (double)(current_read - list->old_disk_read_sectors) * 512.0 / 1024.0;
+    // the previous counters live in prev_list, so the rate always covers one refresh
+    unsigned long long old_read = prev_list ? prev_list->old_disk_read_sectors : 0;
+    unsigned long long old_write = prev_list ? prev_list->old_disk_write_sectors : 0;
+    if (old_read > 0) {
+        if (current_read >= old_read)
+             info->disk_read_rate = (double)(current_read - old_read) * 512.0 / 1024.0;
         else info->disk_read_rate = 0;
         
-        if (current_write >= list->old_disk_write_sectors)
-             info->disk_write_rate = (double)(current_write - list->old_disk_write_sectors) * 512.0 / 1024.0;
+        if (current_write >= old_write)
+             info->disk_write_rate = (double)(current_write - old_write) * 512.0 / 1024.0;
         else info->disk_write_rate = 0;
     }
     list->old_disk_read_sectors = current_read;
     list->old_disk_write_sectors = current_write;
 
-    // Per-core CPU stats
-    FILE *fstat = fopen("/proc/stat", "r");
-    if (fstat) {
-        char line[512];
-        int core_idx = 0;
-        while (fgets(line, sizeof(line), fstat)) {
-            if (strncmp(line, "cpu", 3) == 0 && line[3] >= '0' && line[3] <= '9') {
-                if (core_idx >= 32) break; // max 32 cores
-                unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
-                sscanf(line, "%*s %llu %llu %llu %llu %llu %llu %llu %llu", 
-                       &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal);
-                
-                unsigned long long total = user + nice + system + idle + iowait + irq + softirq + steal;
-                unsigned long long idle_total = idle + iowait;
-                
-                unsigned long long diff_total = 0;
-                unsigned long long diff_idle = 0;
-                
-                if (list->core_old_totals[core_idx] > 0) {
-                    diff_total = total - list->core_old_totals[core_idx];
-                    diff_idle = idle_total - list->core_old_idles[core_idx];
-                }
-                
-                if (diff_total > 0) {
-                    info->core_percents[core_idx] = (float)(diff_total - diff_idle) / diff_total * 100.0f;
-                } else {
-                    info->core_percents[core_idx] = 0;
-                }
-                
-                list->core_old_totals[core_idx] = total;
-                list->core_old_idles[core_idx] = idle_total;
-                
-                core_idx++;
-            }
-        }
-        info->core_count = core_idx;
-        fclose(fstat);
-    }
+    // Per-core CPU stats, as many cores as the box has
+    cpu_stats_usage(&list->cpu, prev_list ? &prev_list->cpu : NULL);
+    info->core_percents = list->cpu.core_percents;
+    info->core_count = list->cpu.core_count;
 
-    // Temperature sensors - different systems have different paths :/
+    // Temperature sensors - the zone and battery were picked by discover_sys_files()
     long temp_mc = 0;
-    int found_temp = 0;
-    
-    const char *priority_names[] = {"x86_pkg_temp", "TCPU", "INT3400 Thermal", "acpitz", "SEN1", NULL};
-    
-    for (int p = 0; priority_names[p] != NULL && !found_temp; p++) {
-        for (int i = 0; i < 10; i++) {
-            char type_path[64], type_buf[64];
-            snprintf(type_path, sizeof(type_path), "/sys/class/thermal/thermal_zone%d/type", i);
-            FILE *f_type = fopen(type_path, "r");
-            if (f_type) {
-                if (fgets(type_buf, sizeof(type_buf), f_type)) {
-                    type_buf[strcspn(type_buf, "\n")] = 0;
-                    if (strcasecmp(type_buf, priority_names[p]) == 0) {
-                        char temp_path[64];
-                        snprintf(temp_path, sizeof(temp_path), "/sys/class/thermal/thermal_zone%d/temp", i);
-                        FILE *f_temp = fopen(temp_path, "r");
-                        if (f_temp) {
-                            if (fscanf(f_temp, "%ld", &temp_mc) == 1) {
-                                info->cpu_temp = temp_mc / 1000.0;
-                                found_temp = 1;
-                            }
-                            fclose(f_temp);
-                        }
-                    }
-                }
-                fclose(f_type);
-            }
-            if (found_temp) break;
-        }
+    if (pread_long(sys_files.cpu_temp, &temp_mc) == 0) {
+        info->cpu_temp = temp_mc / 1000.0;
     }
-    
-    if (!found_temp) {
-         // fallback to zone0
-         FILE *ft = fopen("/sys/class/thermal/thermal_zone0/temp", "r");
-         if (ft) {
-             if (fscanf(ft, "%ld", &temp_mc) == 1) info->cpu_temp = temp_mc / 1000.0;
-             fclose(ft);
-         }
-    }
-    
+
     // Battery temp (if exists)
     long bat_mc = 0;
-    FILE *fb = fopen("/sys/class/power_supply/BAT0/temp", "r");
-    if (!fb) fb = fopen("/sys/class/power_supply/BAT1/temp", "r");
-    if (fb) {
-         if (fscanf(fb, "%ld", &bat_mc) == 1) {
-             if (bat_mc > 1000) info->bat_temp = bat_mc / 1000.0;
-             else info->bat_temp = bat_mc / 10.0;
-         }
-         fclose(fb);
+    if (pread_long(sys_files.bat_temp, &bat_mc) == 0) {
+        if (bat_mc > 1000) info->bat_temp = bat_mc / 1000.0;
+        else info->bat_temp = bat_mc / 10.0;
+    }
+}
+
+// cached /proc handle - opened once, reused for every openat() and readdir
+static DIR *proc_dir = NULL;
+static int proc_fd = -1;
+
+static int open_proc_dir(void) {
+    if (proc_dir) {
+        rewinddir(proc_dir);
+        return 0;
     }
+    proc_dir = opendir("/proc");
+    if (!proc_dir) return -1;
+    proc_fd = dirfd(proc_dir);
+    return 0;
+}
+
+// reads /proc/<pid>/<file> with a single read() into buf (NUL terminated)
+// returns bytes read, or -1 if the process went away
+static ssize_t read_proc_file(pid_t pid, const char *file, char *buf, size_t size) {
+    char path[64];
+    snprintf(path, sizeof(path), "%d/%s", pid, file);
+
+    int fd = openat(proc_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    ssize_t len = read(fd, buf, size - 1);
+    close(fd);
+    if (len < 0) return -1;
+
+    buf[len] = '\0';
+    return len;
 }
 
+// small hand-rolled number parsers - way cheaper than strtok + atoi
+static unsigned long long parse_ull(const char **s) {
+    const char *p = *s;
+    unsigned long long v = 0;
+    while (*p == ' ' || *p == '\t') p++;
+    while (*p >= '0' && *p <= '9') v = v * 10 + (unsigned long long)(*p++ - '0');
+    *s = p;
+    return v;
+}
+
+static long parse_long(const char **s) {
+    const char *p = *s;
+    while (*p == ' ' || *p == '\t') p++;
+    int neg = 0;
+    if (*p == '-') { neg = 1; p++; }
+    *s = p;
+    long v = (long)parse_ull(s);
+    return neg ? -v : v;
+}
+
+static void skip_fields(const char **s, int n) {
+    const char *p = *s;
+    while (n-- > 0) {
+        while (*p == ' ') p++;
+        while (*p && *p != ' ') p++;
+    }
+    *s = p;
+}
+
+// staging record a collector worker fills for one PID. the merge packs
+// these into the snapshot's columns and string arena
+typedef struct {
+    pid_t pid;
+    uid_t uid;
+    int ppid;
+    int threads;
+    int priority;
+    int nice;
+    char state;
+    unsigned long long utime;
+    unsigned long long stime;
+    unsigned long long starttime;
+    long unsigned int memory_sq;
+    long unsigned int rss_peak;
+    unsigned long long cpu_delay;
+    unsigned long long io_delay;
+    float cpu_usage;
+    unsigned long long io_read;
+    unsigned long long io_write;
+    unsigned long long io_syscr;
+    unsigned long long io_syscw;
+    float io_rate[4];          // read, write, syscr, syscw per second
+    int io_status;
+    int prev_row;              // row in prev_list whose text is still valid, -1 = read fresh
+    int prev_same;             // row in prev_list of the same process, -1 = new
+    int enriched;              // status and cmdline were read (or carried over)
+    int worker;                // collector whose arena holds `command` and `cgroup`
+    unsigned int command;      // full cmdline, offset into that worker's arena
+    unsigned int cgroup;       // cgroup v2 path in the same arena, 0 = carry it over
+    char name[64];
+} ProcRecord;
+
+// per-thread collector state. command lines can be any length, so they're
+// read into a growable buffer and parked in the worker's own arena until
+// the merge interns them into the snapshot
+typedef struct {
+    StringArena text;
+    char *buf;
+    size_t buf_size;
+    int ts_sock;               // taskstats socket, -1 = not open (yet)
+    int ts_opened;
+} CollectWorker;
+
+#define CMDLINE_MAX (256 * 1024) // sanity cap, real ones are a few KB at most
+
 // parse /proc/[pid]/stat - this format is annoying because of the (comm) field
-static void get_process_stats(const char *pid_str, ProcessInfo *proc) {
-    char path[256];
-    snprintf(path, sizeof(path), "/proc/%s/stat", pid_str);
-    FILE *f = fopen(path, "r");
-    if (!f) return;
-
-    char buffer[2048];
-    if (fgets(buffer, sizeof(buffer), f)) {
-        char *open_paren = strchr(buffer, '(');
-        char *close_paren = strrchr(buffer, ')');
-        if (open_paren && close_paren && close_paren > open_paren) {
-             size_t len = close_paren - open_paren - 1;
-             if (len > sizeof(proc->name) - 1) len = sizeof(proc->name) - 1;
-             
-             strncpy(proc->name, open_paren + 1, len);
-             proc->name[len] = '\0';
-             
-             strncpy(proc->command, proc->name, sizeof(proc->command)-1);
-             
-             char *rest = close_paren + 2;
-             proc->state = *rest;
-             
-             unsigned long long utime = 0, stime = 0;
-             int ppid = 0, priority = 0, nice = 0, threads = 1;
-             
-             // parse the fields after state
-             int field = 0;
-             char *token = strtok(rest, " ");
-             while (token) {
-                 if (field == 1) ppid = atoi(token);
-                 if (field == 11) utime = strtoull(token, NULL, 10);
-                 if (field == 12) stime = strtoull(token, NULL, 10);
-                 if (field == 15) priority = atoi(token);
-                 if (field == 16) nice = atoi(token);
-                 if (field == 17) threads = atoi(token);
-                 
-                 if (field > 17) break;
-                 token = strtok(NULL, " ");
-                 field++;
-             }
-             proc->utime = utime;
-             proc->stime = stime;
-             proc->ppid = ppid;
-             proc->priority = priority;
-             proc->nice = nice;
-             proc->threads = threads;
-             
-             // map state char to readable name
-             switch (proc->state) {
-                 case 'R': strcpy(proc->status_name, "Running"); break;
-                 case 'S': strcpy(proc->status_name, "Sleeping"); break;
-                 case 'D': strcpy(proc->status_name, "Disk Sleep"); break;
-                 case 'Z': strcpy(proc->status_name, "Zombie"); break;
-                 case 'T': strcpy(proc->status_name, "Stopped"); break;
-                 case 't': strcpy(proc->status_name, "Tracing"); break;
-                 case 'X': strcpy(proc->status_name, "Dead"); break;
-                 case 'x': strcpy(proc->status_name, "Dead"); break;
-                 case 'K': strcpy(proc->status_name, "Wakekill"); break;
-                 case 'W': strcpy(proc->status_name, "Waking"); break;
-                 case 'P': strcpy(proc->status_name, "Parked"); break;
-                 case 'I': strcpy(proc->status_name, "Idle"); break;
-                 default:  snprintf(proc->status_name, 16, "Unknown(%c)", proc->state); break;
-             }
+static int parse_stat(const char *buffer, ProcRecord *proc) {
+    const char *open_paren = strchr(buffer, '(');
+    const char *close_paren = strrchr(buffer, ')');
+    if (!open_paren || !close_paren || close_paren <= open_paren) return -1;
+
+    size_t len = close_paren - open_paren - 1;
+    if (len > sizeof(proc->name) - 1) len = sizeof(proc->name) - 1;
+    memcpy(proc->name, open_paren + 1, len);
+    proc->name[len] = '\0';
+
+    // fields after the comm, counting state as field 0
+    const char *p = close_paren + 2;
+    proc->state = *p++;
+    proc->ppid = (int)parse_long(&p);       // 1
+    skip_fields(&p, 9);                     // 2..10
+    proc->utime = parse_ull(&p);            // 11
+    proc->stime = parse_ull(&p);            // 12
+    skip_fields(&p, 2);                     // 13..14
+    proc->priority = (int)parse_long(&p);   // 15
+    proc->nice = (int)parse_long(&p);       // 16
+    proc->threads = (int)parse_long(&p);    // 17
+    skip_fields(&p, 1);                     // 18
+    proc->starttime = parse_ull(&p);        // 19
+    skip_fields(&p, 1);                     // 20
+
+    static long page_kb = 0;
+    if (!page_kb) page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    proc->memory_sq = (long unsigned int)parse_ull(&p) * page_kb; // 21, rss in pages
+    return 0;
+}
+
+// one pass over /proc/[pid]/status for everything we need from it
+static void parse_status(const char *buffer, ProcRecord *proc) {
+    const char *line = buffer;
+    while (line && *line) {
+        if (strncmp(line, "Uid:", 4) == 0) {
+            const char *p = line + 4;
+            proc->uid = (uid_t)parse_ull(&p);
+        } else if (strncmp(line, "VmHWM:", 6) == 0) {
+            const char *p = line + 6;
+            proc->rss_peak = (long unsigned int)parse_ull(&p);
+        } else if (strncmp(line, "VmRSS:", 6) == 0) {
+            const char *p = line + 6;
+            proc->memory_sq = (long unsigned int)parse_ull(&p);
+            break; // nothing we want comes after VmRSS
         }
+        line = strchr(line, '\n');
+        if (line) line++;
     }
-    fclose(f);
 }
 
-static uid_t get_uid(const char *pid_str) {
-    char path[256];
-    snprintf(path, sizeof(path), "/proc/%s/status", pid_str);
-    FILE *f = fopen(path, "r");
-    if (!f) return 0;
+// /proc/[pid]/io - bytes that actually went to/from storage, plus syscall counts
+static void parse_io(const char *buffer, ProcRecord *proc) {
+    const char *line = buffer;
+    while (line && *line) {
+        const char *p = line;
+        if (strncmp(line, "syscr:", 6) == 0) {
+            p += 6;
+            proc->io_syscr = parse_ull(&p);
+        } else if (strncmp(line, "syscw:", 6) == 0) {
+            p += 6;
+            proc->io_syscw = parse_ull(&p);
+        } else if (strncmp(line, "read_bytes:", 11) == 0) {
+            p += 11;
+            proc->io_read = parse_ull(&p);
+        } else if (strncmp(line, "write_bytes:", 12) == 0) {
+            p += 12;
+            proc->io_write = parse_ull(&p);
+            break; // cancelled_write_bytes is all that's left
+        }
+        line = strchr(line, '\n');
+        if (line) line++;
+    }
+    proc->io_status = IO_OK;
+}
 
-    char line[256];
-    uid_t uid = 0;
-    while (fgets(line, sizeof(line), f)) {
-        if (strncmp(line, "Uid:", 4) == 0) {
-            sscanf(line, "Uid: %u", &uid);
-            break;
+// reads all of /proc/[pid]/cmdline into the worker's buffer, growing it as needed
+static ssize_t read_cmdline(pid_t pid, CollectWorker *w) {
+    char path[64];
+    snprintf(path, sizeof(path), "%d/cmdline", pid);
+
+    int fd = openat(proc_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    size_t len = 0;
+    for (;;) {
+        if (len + 1 >= w->buf_size) {
+            if (w->buf_size >= CMDLINE_MAX) break; // keep what we have
+            size_t new_size = w->buf_size ? w->buf_size * 2 : 4096;
+            char *new_buf = realloc(w->buf, new_size);
+            if (!new_buf) break;
+            w->buf = new_buf;
+            w->buf_size = new_size;
         }
+        ssize_t n = read(fd, w->buf + len, w->buf_size - len - 1);
+        if (n <= 0) break;
+        len += n;
+    }
+    close(fd);
+
+    if (w->buf) w->buf[len] = '\0';
+    return len;
+}
+
+static void parse_cmdline(char *buffer, ssize_t len, ProcRecord *proc, CollectWorker *w) {
+    if (len <= 0) return; // kernel threads have an empty cmdline
+
+    // cmdline args are null-separated, replace with spaces
+    while (len > 0 && buffer[len - 1] == '\0') len--;
+    for (ssize_t i = 0; i < len; i++) {
+        if (buffer[i] == '\0') buffer[i] = ' ';
     }
-    fclose(f);
-    return uid;
+    proc->command = arena_add(&w->text, buffer, len);
 }
 
-static void get_cmdline(const char *pid_str, char *buffer, size_t size) {
-    char path[256];
-    snprintf(path, sizeof(path), "/proc/%s/cmdline", pid_str);
-    FILE *f = fopen(path, "r");
-    if (!f) return;
+static CollectBackend collector_backend = BACKEND_PROCFS;
+static int collect_io = 0; // read /proc/<pid>/io too, see set_collector_io()
+static int collect_cgroups = 0;
 
-    size_t len = fread(buffer, 1, size - 1, f);
-    if (len > 0) {
-        buffer[len] = '\0';
-        // cmdline args are null-separated, replace with spaces
-        for (size_t i = 0; i < len - 1; i++) {
-            if (buffer[i] == '\0') buffer[i] = ' ';
+#define CGROUP_RECHECK 30 // refreshes between two reads of a process' cgroup file
+
+// which cgroup each process is in. it hardly ever changes, so it's read
+// for new processes and carried over after that - except that every
+// process gets looked at again every CGROUP_RECHECK refreshes (spread out
+// by PID), to catch the ones a runtime moved after they started
+void set_collector_cgroups(int enabled) {
+    collect_cgroups = enabled;
+}
+
+// the "0::<path>" line of /proc/<pid>/cgroup, the v2 unified hierarchy.
+// a v1-only host doesn't have one, those processes stay at ""
+static void read_cgroup(ProcRecord *r, CollectWorker *w, char *buf, size_t size) {
+    if (read_proc_file(r->pid, "cgroup", buf, size) <= 0) return;
+    for (const char *line = buf; line && *line; ) {
+        const char *end = strchr(line, '\n');
+        if (strncmp(line, "0::", 3) == 0) {
+            size_t len = end ? (size_t)(end - line - 3) : strlen(line + 3);
+            if (len > 0) r->cgroup = arena_add(&w->text, line + 3, len);
+            return;
         }
+        line = end ? end + 1 : NULL;
     }
-    fclose(f);
 }
 
-void refresh_process_list(ProcessList *list, ProcessList *prev_list) {
-    unsigned long long current_total_cpu = 0, current_idle_cpu = 0;
-    
-    get_system_cpu_times(&current_total_cpu, &current_idle_cpu);
-    
-    unsigned long long total_diff = 0;
-    
-    if (prev_list && prev_list->total_cpu_time > 0) {
-        if (current_total_cpu >= prev_list->total_cpu_time) {
-            total_diff = current_total_cpu - prev_list->total_cpu_time;
+// the cgroups' own files under /sys/fs/cgroup, once per distinct cgroup
+// per refresh. only while something shows them, set from the refreshing thread
+static int collect_cgroup_stats = 0;
+static char cgroup_root[64];       // where the v2 hierarchy is mounted, "" = nowhere
+static int cgroup_root_checked = 0;
+static int *cgroup_seen = NULL;    // cgroup offset -> stats entry, -1 = empty
+static unsigned int cgroup_seen_size = 0;
+
+void set_collector_cgroup_stats(int enabled) {
+    collect_cgroup_stats = enabled;
+}
+
+// cgroup2 on its own (/sys/fs/cgroup), or next to v1 in a hybrid setup
+static void find_cgroup_root(void) {
+    static const char *candidates[] = { "/sys/fs/cgroup", "/sys/fs/cgroup/unified" };
+    cgroup_root_checked = 1;
+    cgroup_root[0] = '\0';
+    for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+        char path[96];
+        snprintf(path, sizeof(path), "%s/cgroup.controllers", candidates[i]);
+        if (access(path, F_OK) == 0) {
+            snprintf(cgroup_root, sizeof(cgroup_root), "%s", candidates[i]);
+            return;
         }
     }
-    list->total_cpu_time = current_total_cpu;
-    list->total_cpu_idle = current_idle_cpu;
+}
 
-    DIR *proc = opendir("/proc");
-    if (!proc) return;
+// reads <root><cgroup>/<file> into buf, -1 if it isn't there or can't be read
+static ssize_t read_cgroup_file(const char *cgroup, const char *file, char *buf, size_t size) {
+    char path[4096 + 128];
+    if (strcmp(cgroup, "/") == 0) cgroup = ""; // the root cgroup
+    snprintf(path, sizeof(path), "%s%s/%s", cgroup_root, cgroup, file);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t len = read(fd, buf, size - 1);
+    close(fd);
+    if (len <= 0) return -1;
+    buf[len] = '\0';
+    return len;
+}
 
-    list->count = 0;
+static void read_cgroup_stats(CgroupStats *st, const char *path) {
+    char buf[512];
+    st->usage_usec = 0;
+    st->usage_ok = 0;
+    st->memory = -1;
+    st->pressure = -1.0f;
+    if (!cgroup_root[0] || !path[0]) return;
 
+    if (read_cgroup_file(path, "cpu.stat", buf, sizeof(buf)) > 0) {
+        char *p = strstr(buf, "usage_usec ");
+        if (p) {
+            st->usage_usec = strtoull(p + 11, NULL, 10);
+            st->usage_ok = 1;
+        }
+    }
+    // not at the root, and only with the memory controller on v2
+    if (read_cgroup_file(path, "memory.current", buf, sizeof(buf)) > 0) {
+        st->memory = (long long)(strtoull(buf, NULL, 10) / 1024);
+    }
+    // "some avg10=0.00 avg60=...", how much of the last 10s something waited on memory
+    if (read_cgroup_file(path, "memory.pressure", buf, sizeof(buf)) > 0) {
+        char *p = strstr(buf, "some avg10=");
+        if (p) st->pressure = strtof(p + 11, NULL);
+    }
+}
+
+// one CgroupStats per distinct cgroup. the paths are interned in the
+// snapshot, so the same path is the same offset and that's the key
+static void refresh_cgroup_stats(ProcessList *list) {
+    list->cgroup_stats_count = 0;
+    if (!collect_cgroup_stats || list->count == 0) return;
+    if (!cgroup_root_checked) find_cgroup_root();
+
+    unsigned int want = 64;
+    while (want < (unsigned int)list->count * 2) want *= 2;
+    if (want > cgroup_seen_size) {
+        int *p = realloc(cgroup_seen, sizeof(int) * want);
+        if (!p) return;
+        cgroup_seen = p;
+        cgroup_seen_size = want;
+    }
+    memset(cgroup_seen, -1, sizeof(int) * cgroup_seen_size);
+    unsigned int mask = cgroup_seen_size - 1;
+
+    for (int i = 0; i < list->count; i++) {
+        unsigned int off = list->cgroup[i];
+        unsigned int slot = (off * 2654435761u) & mask;
+        while (cgroup_seen[slot] >= 0 && list->cgroup_stats[cgroup_seen[slot]].path != off) slot = (slot + 1) & mask;
+        if (cgroup_seen[slot] >= 0) continue;
+
+        if (list->cgroup_stats_count == list->cgroup_stats_capacity) {
+            int cap = list->cgroup_stats_capacity ? list->cgroup_stats_capacity * 2 : 64;
+            CgroupStats *p = realloc(list->cgroup_stats, sizeof(CgroupStats) * cap);
+            if (!p) return;
+            list->cgroup_stats = p;
+            list->cgroup_stats_capacity = cap;
+        }
+        CgroupStats *st = &list->cgroup_stats[list->cgroup_stats_count];
+        st->path = off;
+        read_cgroup_stats(st, arena_str(&list->text, off));
+        cgroup_seen[slot] = list->cgroup_stats_count++;
+    }
+}
+
+// per-process I/O rates cost one more read per process per refresh, so
+// only what shows them (the UI) turns them on
+void set_collector_io(int enabled) {
+    collect_io = enabled;
+}
+
+// taskstats backend: CPU time (summed over threads, in microseconds) and
+// delay accounting from a TGID query, and for a new process the uid and
+// peak RSS from a PID query - which saves reading status. stat is still
+// read first, taskstats has no state, thread count or current RSS
+static int collect_taskstats(ProcRecord *r, CollectWorker *w, int new_process) {
+    if (!w->ts_opened) {
+        w->ts_sock = taskstats_open();
+        w->ts_opened = 1;
+    }
+    if (w->ts_sock < 0) return -1;
+
+    TaskStats ts;
+    if (taskstats_query_tgid(w->ts_sock, r->pid, &ts) != 0) return -1;
+
+    // microseconds -> clock ticks, so the CPU % math stays the same
+    static long clk_tck = 0;
+    if (!clk_tck) clk_tck = sysconf(_SC_CLK_TCK);
+    r->utime = ts.utime_us * clk_tck / 1000000;
+    r->stime = ts.stime_us * clk_tck / 1000000;
+    r->cpu_delay = ts.cpu_delay_ns;
+    r->io_delay = ts.io_delay_ns;
+
+    if (new_process && taskstats_query_pid(w->ts_sock, r->pid, &ts) != 0) return -1;
+    if (new_process) {
+        r->uid = ts.uid;
+        r->rss_peak = ts.rss_peak_kb;
+    }
+    return 0;
+}
+
+// tier 2 - status and cmdline - only for these PIDs (sorted), or for all
+// of them while wanted_count < 0. sampler thread only, see set_collector_wanted()
+static pid_t *wanted = NULL;
+static int wanted_count = -1;
+static int wanted_cap = 0;
+
+static int cmp_pid(const void *a, const void *b) {
+    pid_t x = *(const pid_t *)a, y = *(const pid_t *)b;
+    return (x > y) - (x < y);
+}
+
+// the UI only shows a screenful of rows, so only those (and the selected
+// process) need a user name and command line. everyone else gets stat,
+// which is all sorting needs, and keeps whatever an earlier refresh read.
+// count < 0 means everybody, which is the default - headless output and
+// recordings want every row complete. call from the refreshing thread
+void set_collector_wanted(const pid_t *pids, int count) {
+    if (count < 0) {
+        wanted_count = -1;
+        return;
+    }
+    if (count > wanted_cap) {
+        pid_t *p = realloc(wanted, sizeof(pid_t) * count);
+        if (!p) {
+            wanted_count = -1; // reading everything is slow, not wrong
+            return;
+        }
+        wanted = p;
+        wanted_cap = count;
+    }
+    if (count > 0) {
+        memcpy(wanted, pids, sizeof(pid_t) * count);
+        qsort(wanted, count, sizeof(pid_t), cmp_pid);
+    }
+    wanted_count = count;
+}
+
+static int is_wanted(pid_t pid) {
+    if (wanted_count < 0) return 1;
+    if (wanted_count == 0) return 0;
+    return bsearch(&pid, wanted, wanted_count, sizeof(pid_t), cmp_pid) != NULL;
+}
+
+// reads stat, status and cmdline once each into the caller's scratch buffer.
+// if row prev_row of prev_list is the same process, only stat is read -
+// its text (user, cmdline) can't change without an exec, so the merge
+// copies it over instead. status and cmdline are the second tier: a
+// process nobody is looking at only gets stat (see set_collector_wanted).
+// the user name is always left to the merge (the cache isn't thread safe)
+static int collect_process(ProcRecord *r, const ProcessList *prev_list, int prev_row,
+                           CollectWorker *w, char *buf, size_t size) {
+    ssize_t len = read_proc_file(r->pid, "stat", buf, size);
+    if (len <= 0 || parse_stat(buf, r) != 0) return -1; // process probably died
+
+    // first tier too, sorting by I/O needs every row. no ptrace rights
+    // on the process (someone else's, without root) = EACCES
+    if (collect_io) {
+        if (read_proc_file(r->pid, "io", buf, size) > 0) parse_io(buf, r);
+        else r->io_status = IO_DENIED;
+    }
+
+    int want = is_wanted(r->pid);
+
+    // same start time = same process, same comm = no exec since last time
+    if (prev_row >= 0 && prev_list->starttime[prev_row] == r->starttime &&
+        strcmp(arena_str(&prev_list->text, prev_list->name[prev_row]), r->name) == 0) {
+        r->uid = prev_list->uid[prev_row];
+        r->rss_peak = prev_list->rss_peak[prev_row]; // the merge keeps it >= current RSS
+        if (prev_list->enriched[prev_row] || !want) {
+            r->prev_row = prev_list->enriched[prev_row] ? prev_row : -1;
+            r->enriched = prev_list->enriched[prev_row];
+            if (collector_backend == BACKEND_TASKSTATS) collect_taskstats(r, w, 0);
+            return 0;
+        }
+        // only had the first tier so far, and now someone's looking
+    }
+
+    if (!want) {
+        if (collector_backend == BACKEND_TASKSTATS) collect_taskstats(r, w, 0);
+        return 0;
+    }
+    r->enriched = 1;
+
+    // if taskstats can't answer (e.g. it just exited), fall back to status
+    if (collector_backend != BACKEND_TASKSTATS || collect_taskstats(r, w, 1) != 0) {
+        if (read_proc_file(r->pid, "status", buf, size) > 0) {
+            parse_status(buf, r);
+        }
+    }
+
+    len = read_cmdline(r->pid, w);
+    parse_cmdline(w->buf, len, r, w);
+    return 0;
+}
+
+// --- PSS/USS/swap ---
+// smaps_rollup walks every mapping of the process, so it costs far more
+// than stat. each refresh spends at most smaps_budget_us on it: rows on
+// screen first, then whatever has gone longest without a read, weighted
+// by RSS so big processes don't sit behind a thousand tiny ones
+
+#define SMAPS_MIN_AGE_MS 500       // read more recently than this, skip it
+#define SMAPS_NEVER_AGE_MS 3600000 // how old "never read" counts as
+#define SMAPS_DENIED_RETRY_MS 60000
+
+static int smaps_budget_us = 0;    // 0 = off
+static SortKey *smaps_keys = NULL; // 2 * smaps_keys_cap, for the radix sort
+static int smaps_keys_cap = 0;
+
+// time the collector may spend on smaps_rollup per refresh, 0 = never read it
+void set_collector_smaps_budget(int budget_us) {
+    smaps_budget_us = budget_us > 0 ? budget_us : 0;
+}
+
+static unsigned long long monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+// reads one process' smaps_rollup into row `row`
+static void read_smaps(ProcessList *list, int row, unsigned long long now_ms) {
+    char buf[4096];
+    list->smaps_ms[row] = now_ms;
+    if (read_proc_file(list->pid[row], "smaps_rollup", buf, sizeof(buf)) < 0) {
+        // EACCES without ptrace rights, ENOENT once it's gone - same thing to us
+        list->smaps_status[row] = SMAPS_DENIED;
+        return;
+    }
+
+    unsigned long long pss = 0, private_clean = 0, private_dirty = 0, swap = 0;
+    const char *line = buf;
+    while (line && *line) {
+        const char *p = line;
+        if (strncmp(line, "Pss:", 4) == 0) {
+            p += 4;
+            pss = parse_ull(&p);
+        } else if (strncmp(line, "Private_Clean:", 14) == 0) {
+            p += 14;
+            private_clean = parse_ull(&p);
+        } else if (strncmp(line, "Private_Dirty:", 14) == 0) {
+            p += 14;
+            private_dirty = parse_ull(&p);
+        } else if (strncmp(line, "Swap:", 5) == 0) {
+            p += 5;
+            swap = parse_ull(&p);
+        }
+        line = strchr(line, '\n');
+        if (line) line++;
+    }
+
+    // kernel threads have no mm, the file is empty and zeros are right
+    list->pss[row] = (long unsigned int)pss;
+    list->uss[row] = (long unsigned int)(private_clean + private_dirty);
+    list->swap[row] = (long unsigned int)swap;
+    list->smaps_status[row] = SMAPS_OK;
+}
+
+static void refresh_smaps(ProcessList *list) {
+    if (smaps_budget_us == 0 || list->count == 0) return;
+
+    if (list->count > smaps_keys_cap) {
+        SortKey *k = realloc(smaps_keys, sizeof(SortKey) * list->count * 2);
+        if (!k) return;
+        smaps_keys = k;
+        smaps_keys_cap = list->count;
+    }
+
+    unsigned long long start = monotonic_us();
+    unsigned long long now_ms = start / 1000;
+
+    // biggest key first, so the keys are inverted for the ascending sort
+    int n = 0;
+    for (int i = 0; i < list->count; i++) {
+        unsigned long long age = list->smaps_status[i] == SMAPS_NONE ? SMAPS_NEVER_AGE_MS : now_ms - list->smaps_ms[i];
+        if (age < SMAPS_MIN_AGE_MS) continue;
+        if (list->smaps_status[i] == SMAPS_DENIED && age < SMAPS_DENIED_RETRY_MS) continue;
+        if (age > SMAPS_NEVER_AGE_MS) age = SMAPS_NEVER_AGE_MS;
+
+        // RSS capped at 1TB, so age * RSS stays well below the "wanted" bit
+        unsigned long long rss = list->memory_sq[i] < (1UL << 30) ? list->memory_sq[i] : (1UL << 30);
+        unsigned long long key = age * (rss + 1);
+        if (wanted_count >= 0 && is_wanted(list->pid[i])) key |= 1ULL << 62;
+        smaps_keys[n].key = ~key;
+        smaps_keys[n].index = i;
+        n++;
+    }
+    radix_sort_keys(smaps_keys, smaps_keys + n, n);
+
+    for (int k = 0; k < n; k++) {
+        read_smaps(list, smaps_keys[k].index, now_ms);
+        if (monotonic_us() - start >= (unsigned long long)smaps_budget_us) break;
+    }
+}
+
+// --- parallel collection ---
+// the PID set is read up front, then workers grab batches of it and fill
+// records[i] for pids[i]. dead processes leave pid = 0 behind and get
+// squeezed out when the records are merged into the snapshot.
+
+#define MAX_COLLECTOR_THREADS 64
+#define COLLECT_BATCH 64          // PIDs a worker grabs at a time
+#define PARALLEL_MIN_PIDS 1024    // below this threads cost more than they save
+
+typedef struct {
+    ProcRecord *records;
+    const ProcessList *prev_list;
+    int incremental;
+    const pid_t *pids;
+    int pid_count;
+    unsigned long long total_diff;
+    int num_cores;
+    unsigned long long elapsed_ms; // since prev_list was taken, 0 = no rates
+    unsigned int cgroup_round;    // PIDs with pid % CGROUP_RECHECK == this re-read their cgroup
+    atomic_int next;              // next unclaimed index into pids
+} CollectJob;
+
+static struct {
+    pthread_t threads[MAX_COLLECTOR_THREADS];
+    int started;                  // worker threads currently running
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    unsigned long generation;     // bumped for every job
+    int busy;                     // workers still on the current job
+    int shutdown;
+    CollectJob *job;
+} pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work_ready = PTHREAD_COND_INITIALIZER,
+    .work_done = PTHREAD_COND_INITIALIZER,
+};
+
+static int collector_threads = 0; // 0 = pick automatically
+
+// workers[0] is the thread calling refresh_process_list, pool thread i uses workers[i + 1]
+static CollectWorker workers[MAX_COLLECTOR_THREADS];
+
+static pid_t *pid_scratch = NULL;
+static int pid_scratch_cap = 0;
+static ProcRecord *record_scratch = NULL;
+static int record_scratch_cap = 0;
+
+// prev-arena offset -> offset in the new arena. text carried over from the
+// last snapshot is already interned there, so each distinct string only has
+// to be hashed and copied once per refresh, not once per row using it
+typedef struct {
+    unsigned int from;
+    unsigned int to;
+    unsigned int gen;
+} TextRemap;
+
+static TextRemap *remap = NULL;
+static unsigned int remap_size = 0; // power of two
+static unsigned int remap_gen = 0;
+
+// clears the remap and makes room for `entries` strings, 0 if there's no table
+static int reset_remap(int entries) {
+    unsigned int want = 1024;
+    while (want < (unsigned int)entries * 2) want *= 2;
+
+    if (want > remap_size) {
+        TextRemap *new_ptr = calloc(want, sizeof(TextRemap));
+        if (!new_ptr) return 0;
+        free(remap);
+        remap = new_ptr;
+        remap_size = want;
+        remap_gen = 0;
+    }
+    if (++remap_gen == 0) {
+        memset(remap, 0, sizeof(TextRemap) * remap_size);
+        remap_gen = 1;
+    }
+    return 1;
+}
+
+static unsigned int carry_text(StringArena *dst, const StringArena *src, unsigned int offset, int use_remap) {
+    if (offset == 0) return 0;
+
+    TextRemap *slot = NULL;
+    if (use_remap) {
+        unsigned int mask = remap_size - 1;
+        unsigned int i = (offset * 2654435761u) & mask;
+        while (remap[i].gen == remap_gen && remap[i].from != offset) i = (i + 1) & mask;
+        if (remap[i].gen == remap_gen) return remap[i].to;
+        slot = &remap[i];
+    }
+
+    const char *str = arena_str(src, offset);
+    unsigned int to = arena_intern(dst, str, strlen(str));
+    if (slot) {
+        slot->from = offset;
+        slot->to = to;
+        slot->gen = remap_gen;
+    }
+    return to;
+}
+
+// switches how per-process numbers are read. taskstats needs CAP_NET_ADMIN,
+// returns -1 (and keeps reading /proc) if we can't use it
+int set_collector_backend(CollectBackend backend) {
+    if (backend == BACKEND_TASKSTATS) {
+        int sock = taskstats_open();
+        TaskStats ts;
+        int ok = sock >= 0 && taskstats_query_tgid(sock, getpid(), &ts) == 0;
+        taskstats_close(sock);
+        if (!ok) return -1;
+    }
+    collector_backend = backend;
+    return 0;
+}
+
+void set_collector_threads(int threads) {
+    if (threads > MAX_COLLECTOR_THREADS) threads = MAX_COLLECTOR_THREADS;
+    collector_threads = threads;
+}
+
+static void run_collect_job(CollectJob *job, int worker) {
+    char buf[4096];
+    CollectWorker *w = &workers[worker];
+    arena_reset(&w->text); // last job's command lines were merged already
+
+    for (;;) {
+        int begin = atomic_fetch_add(&job->next, COLLECT_BATCH);
+        if (begin >= job->pid_count) break;
+        int end = begin + COLLECT_BATCH;
+        if (end > job->pid_count) end = job->pid_count;
+
+        for (int i = begin; i < end; i++) {
+            ProcRecord *r = &job->records[i];
+            r->pid = job->pids[i];
+            r->uid = 0;
+            r->state = '?';
+            r->threads = 1;
+            r->cpu_usage = 0.0f;
+            r->rss_peak = 0;
+            r->cpu_delay = 0;
+            r->io_delay = 0;
+            r->prev_row = -1;
+            r->prev_same = -1;
+            r->enriched = 0;
+            r->io_read = r->io_write = r->io_syscr = r->io_syscw = 0;
+            memset(r->io_rate, 0, sizeof(r->io_rate));
+            r->io_status = IO_NONE;
+            r->worker = worker;
+            r->command = 0;
+            r->cgroup = 0;
+
+            int k = find_process(job->prev_list, r->pid); // O(1) via the PID index
+
+            if (collect_process(r, job->prev_list, job->incremental ? k : -1, w, buf, sizeof(buf)) != 0) {
+                r->pid = 0; // gone, dropped in the merge
+                continue;
+            }
+
+            if (k >= 0 && job->prev_list->starttime[k] == r->starttime) r->prev_same = k;
+
+            if (collect_cgroups && (r->prev_same < 0 || (unsigned int)r->pid % CGROUP_RECHECK == job->cgroup_round)) {
+                read_cgroup(r, w, buf, sizeof(buf));
+            }
+
+            // CPU usage calculation - compare with previous snapshot
+            if (job->total_diff > 0 && r->prev_same >= 0) {
+                unsigned long long prev_process_time = job->prev_list->utime[k] + job->prev_list->stime[k];
+                unsigned long long curr_process_time = r->utime + r->stime;
+
+                if (curr_process_time >= prev_process_time) {
+                    unsigned long long proc_diff = curr_process_time - prev_process_time;
+
+                    // formula: (process_delta / system_delta) * 100 * num_cores
+                    r->cpu_usage = 100.0f * ((float)proc_diff / (float)job->total_diff);
+                    r->cpu_usage *= job->num_cores;
+                }
+            }
+
+            // I/O rates, the same way against the same previous row
+            if (job->elapsed_ms > 0 && r->prev_same >= 0 && r->io_status == IO_OK &&
+                job->prev_list->io_status[k] == IO_OK) {
+                const ProcessList *pl = job->prev_list;
+                unsigned long long prev[4] = { pl->io_read[k], pl->io_write[k], pl->io_syscr[k], pl->io_syscw[k] };
+                unsigned long long cur[4] = { r->io_read, r->io_write, r->io_syscr, r->io_syscw };
+                for (int j = 0; j < 4; j++) {
+                    if (cur[j] >= prev[j]) r->io_rate[j] = (float)(cur[j] - prev[j]) * 1000.0f / job->elapsed_ms;
+                }
+            }
+        }
+    }
+}
+
+static void* collector_worker(void *arg) {
+    int worker = (int)(intptr_t)arg;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&pool.lock);
+    for (;;) {
+        while (!pool.shutdown && pool.generation == seen) {
+            pthread_cond_wait(&pool.work_ready, &pool.lock);
+        }
+        if (pool.shutdown) break;
+        seen = pool.generation;
+        CollectJob *job = pool.job;
+        pthread_mutex_unlock(&pool.lock);
+
+        run_collect_job(job, worker);
+
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.busy == 0) pthread_cond_signal(&pool.work_done);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    return NULL;
+}
+
+// how many threads to use for this many PIDs (including the caller)
+static int pick_thread_count(int pid_count) {
+    int threads = collector_threads;
+    if (threads <= 0) {
+        if (pid_count < PARALLEL_MIN_PIDS) return 1;
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+        if (threads > 8) threads = 8; // /proc doesn't scale much past this on its own
+    }
+    int max_useful = (pid_count + COLLECT_BATCH - 1) / COLLECT_BATCH;
+    if (threads > max_useful) threads = max_useful;
+    if (threads > MAX_COLLECTOR_THREADS) threads = MAX_COLLECTOR_THREADS;
+    return threads < 1 ? 1 : threads;
+}
+
+// runs the job on `threads` threads, the calling thread being one of them
+static void run_parallel(CollectJob *job, int threads) {
+    pthread_mutex_lock(&pool.lock);
+    while (pool.started < threads - 1) {
+        if (pthread_create(&pool.threads[pool.started], NULL, collector_worker,
+                           (void *)(intptr_t)(pool.started + 1)) != 0) break;
+        pool.started++;
+    }
+    // every started worker picks up the job, the extra ones just find no batches left
+    pool.job = job;
+    pool.busy = pool.started;
+    pool.generation++;
+    pthread_cond_broadcast(&pool.work_ready);
+    pthread_mutex_unlock(&pool.lock);
+
+    run_collect_job(job, 0);
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.busy > 0) pthread_cond_wait(&pool.work_done, &pool.lock);
+    pthread_mutex_unlock(&pool.lock);
+}
+
+// stops the worker threads and closes /proc - call once at exit
+void collector_shutdown(void) {
+    pthread_mutex_lock(&pool.lock);
+    pool.shutdown = 1;
+    pthread_cond_broadcast(&pool.work_ready);
+    pthread_mutex_unlock(&pool.lock);
+
+    for (int i = 0; i < pool.started; i++) pthread_join(pool.threads[i], NULL);
+    pool.started = 0;
+    pool.shutdown = 0;
+
+    if (proc_dir) closedir(proc_dir);
+    proc_dir = NULL;
+    proc_fd = -1;
+
+    free(pid_scratch);
+    pid_scratch = NULL;
+    pid_scratch_cap = 0;
+    free(cgroup_seen);
+    cgroup_seen = NULL;
+    cgroup_seen_size = 0;
+    free(record_scratch);
+    record_scratch = NULL;
+    record_scratch_cap = 0;
+
+    free(remap);
+    remap = NULL;
+    remap_size = 0;
+
+    free(smaps_keys);
+    smaps_keys = NULL;
+    smaps_keys_cap = 0;
+
+    free(wanted);
+    wanted = NULL;
+    wanted_count = -1;
+    wanted_cap = 0;
+
+    for (int i = 0; i < MAX_COLLECTOR_THREADS; i++) {
+        if (workers[i].ts_opened) taskstats_close(workers[i].ts_sock);
+        workers[i].ts_opened = 0;
+        arena_free(&workers[i].text);
+        free(workers[i].buf);
+        workers[i].buf = NULL;
+        workers[i].buf_size = 0;
+    }
+}
+
+// reads the numeric entries of /proc into pid_scratch
+static int scan_pid_dir(void) {
+    int count = 0;
     struct dirent *entry;
-    while ((entry = readdir(proc))) {
+    while ((entry = readdir(proc_dir))) {
         if (!is_numeric(entry->d_name)) continue; // skip non-PID entries
 
-        // resize array if needed
-        if (list->count >= list->capacity) {
-            list->capacity *= 2;
-            ProcessInfo *new_ptr = realloc(list->processes, sizeof(ProcessInfo) * list->capacity);
+        if (count >= pid_scratch_cap) {
+            int new_cap = pid_scratch_cap ? pid_scratch_cap * 2 : 1024;
+            pid_t *new_ptr = realloc(pid_scratch, sizeof(pid_t) * new_cap);
             if (!new_ptr) break; // out of memory, stop here
-            list->processes = new_ptr;
+            pid_scratch = new_ptr;
+            pid_scratch_cap = new_cap;
         }
+        pid_scratch[count++] = atoi(entry->d_name);
+    }
+    return count;
+}
 
-        ProcessInfo *p = &list->processes[list->count];
-        p->pid = atoi(entry->d_name);
-        
-        // initialize
-        p->uid = 0;
-        p->state = '?';
-        p->memory_sq = 0;
-        p->cpu_usage = 0.0f;
-        p->utime = 0;
-        p->stime = 0;
-        memset(p->user, 0, sizeof(p->user));
-        memset(p->command, 0, sizeof(p->command));
-
-        p->uid = get_uid(entry->d_name);
-        get_user_name(p->uid, p->user, sizeof(p->user));
-        p->memory_sq = get_memory_usage(entry->d_name);
-        
-        get_process_stats(entry->d_name, p);
-        
-        // CPU usage calculation - compare with previous snapshot
-        if (prev_list && total_diff > 0) {
-            // find this PID in prev_list (yeah this is O(n^2) but whatever)
-            for (int k = 0; k < prev_list->count; k++) {
-                if (prev_list->processes[k].pid == p->pid) {
-                    unsigned long long prev_process_time = prev_list->processes[k].utime + prev_list->processes[k].stime;
-                    unsigned long long curr_process_time = p->utime + p->stime;
-                    
-                    if (curr_process_time >= prev_process_time) {
-                        unsigned long long proc_diff = curr_process_time - prev_process_time;
-                        
-                        // formula: (process_delta / system_delta) * 100 * num_cores
-                        p->cpu_usage = 100.0f * ((float)proc_diff / (float)total_diff);
-                        
-                        int num_cores = sysconf(_SC_NPROCESSORS_ONLN);
-                        p->cpu_usage *= num_cores;
-                    }
-                    break;
-                }
-            }
+#define PROC_EVENTS_RESYNC 30 // refreshes between /proc scans while events track the PIDs
+
+static int resync_countdown = 0;
+static unsigned int cgroup_round = 0;
+
+// fills pid_scratch with the PIDs to collect. with the proc connector
+// running that's its live set, and /proc only gets scanned as a periodic
+// resync (or right away if events were lost)
+static int read_pid_set(void) {
+    if (proc_events_active() && resync_countdown-- > 0) {
+        int count = proc_events_pids(&pid_scratch, &pid_scratch_cap);
+        if (count >= 0) return count;
+    }
+
+    resync_countdown = PROC_EVENTS_RESYNC;
+    int count = scan_pid_dir();
+    proc_events_add(pid_scratch, count);
+    return count;
+}
+
+void refresh_process_list(ProcessList *list, ProcessList *prev_list) {
+    // the one /proc/stat read per refresh, get_system_info() uses it too
+    if (cpu_stats_read(&list->cpu) != 0) {
+        list->cpu.total = (CpuTimes){0};
+        list->cpu.core_count = 0;
+    }
+    unsigned long long current_total_cpu = cpu_times_total(&list->cpu.total);
+
+    unsigned long long total_diff = 0;
+    unsigned long long prev_total_cpu = prev_list ? cpu_times_total(&prev_list->cpu.total) : 0;
+    if (prev_total_cpu > 0 && current_total_cpu >= prev_total_cpu) {
+        total_diff = current_total_cpu - prev_total_cpu;
+    }
+
+    user_cache_revalidate();
+    list->user_generation = user_cache_generation();
+    int users_stale = prev_list && prev_list->user_generation != list->user_generation;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    list->sample_ms = (unsigned long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    unsigned long long elapsed_ms = 0;
+    if (prev_list && prev_list->sample_ms && list->sample_ms > prev_list->sample_ms) {
+        elapsed_ms = list->sample_ms - prev_list->sample_ms;
+    }
+
+    if (open_proc_dir() != 0) return;
+
+    list->count = 0;
+    arena_reset(&list->text);
+
+    int pid_count = read_pid_set();
+
+    // resize arrays if needed - every PID gets a record and a row up front
+    if (pid_count > record_scratch_cap) {
+        ProcRecord *new_ptr = realloc(record_scratch, sizeof(ProcRecord) * pid_count);
+        if (!new_ptr) {
+            pid_count = record_scratch_cap; // out of memory, do what fits
+        } else {
+            record_scratch = new_ptr;
+            record_scratch_cap = pid_count;
         }
-        
-        // get full command line
-        char cmdline[MAX_CMD_LEN];
-        cmdline[0] = '\0';
-        get_cmdline(entry->d_name, cmdline, sizeof(cmdline));
-        if (strlen(cmdline) > 0) {
-             strncpy(p->command, cmdline, sizeof(p->command) - 1);
-             p->command[sizeof(p->command) - 1] = '\0';
+    }
+    if (reserve_process_list(list, pid_count) != 0 && pid_count > list->capacity) {
+        pid_count = list->capacity; // still within record_scratch, that clamp stands
+    }
+
+    CollectJob job = {
+        .records = record_scratch,
+        .prev_list = prev_list,
+        .incremental = list->incremental,
+        .pids = pid_scratch,
+        .pid_count = pid_count,
+        .total_diff = total_diff,
+        .num_cores = sysconf(_SC_NPROCESSORS_ONLN),
+        .elapsed_ms = elapsed_ms,
+        .cgroup_round = cgroup_round,
+    };
+    cgroup_round = (cgroup_round + 1) % CGROUP_RECHECK;
+    atomic_init(&job.next, 0);
+
+    int threads = pick_thread_count(pid_count);
+    if (threads > 1) run_parallel(&job, threads);
+    else run_collect_job(&job, 0);
+
+    int use_remap = prev_list && reset_remap(prev_list->count * 4);
+
+    // merge: pack the live records into the columns and their text into the
+    // arena. filtering is a separate view over the snapshot (apply_filter),
+    // so everything is kept here. text is interned, so the hundred copies of
+    // the same worker command line or user name are stored once
+    for (int i = 0; i < pid_count; i++) {
+        const ProcRecord *r = &record_scratch[i];
+        if (r->pid == 0) {
+            proc_events_forget(pid_scratch[i]); // in case its exit event got lost
+            continue;
         }
 
-        // apply filter if active
-        if (list->filter[0] != '\0') {
-            char pid_str[32];
-            snprintf(pid_str, 32, "%d", p->pid);
-            
-            if (!strcasestr(p->command, list->filter) && 
-                !strcasestr(p->user, list->filter) &&
-                !strstr(pid_str, list->filter)) {
-                continue; // doesn't match, skip it
+        int row = list->count++;
+        list->pid[row] = r->pid;
+        list->uid[row] = r->uid;
+        list->ppid[row] = r->ppid;
+        list->utime[row] = r->utime;
+        list->stime[row] = r->stime;
+        list->starttime[row] = r->starttime;
+        list->memory_sq[row] = r->memory_sq;
+        list->cpu_usage[row] = r->cpu_usage;
+        list->threads[row] = r->threads;
+        list->priority[row] = r->priority;
+        list->nice[row] = r->nice;
+        list->state[row] = r->state;
+        list->rss_peak[row] = r->rss_peak > r->memory_sq ? r->rss_peak : r->memory_sq;
+        list->cpu_delay[row] = r->cpu_delay;
+        list->io_delay[row] = r->io_delay;
+        list->enriched[row] = (unsigned char)r->enriched;
+        list->io_read[row] = r->io_read;
+        list->io_write[row] = r->io_write;
+        list->io_syscr[row] = r->io_syscr;
+        list->io_syscw[row] = r->io_syscw;
+        list->io_read_rate[row] = r->io_rate[0];
+        list->io_write_rate[row] = r->io_rate[1];
+        list->io_syscr_rate[row] = r->io_rate[2];
+        list->io_syscw_rate[row] = r->io_rate[3];
+        list->io_status[row] = (unsigned char)r->io_status;
+        if (r->prev_same >= 0) {
+            // smaps values are kept until their turn comes up again
+            list->pss[row] = prev_list->pss[r->prev_same];
+            list->uss[row] = prev_list->uss[r->prev_same];
+            list->swap[row] = prev_list->swap[r->prev_same];
+            list->smaps_ms[row] = prev_list->smaps_ms[r->prev_same];
+            list->smaps_status[row] = prev_list->smaps_status[r->prev_same];
+        } else {
+            list->pss[row] = list->uss[row] = list->swap[row] = 0;
+            list->smaps_ms[row] = 0;
+            list->smaps_status[row] = SMAPS_NONE;
+        }
+
+        list->name[row] = arena_intern(&list->text, r->name, strlen(r->name));
+        if (r->prev_row >= 0) {
+            if (users_stale) {
+                // /etc/passwd changed, a carried name could be a renamed user's old one
+                const char *user = lookup_user_name(r->uid);
+                list->user[row] = arena_intern(&list->text, user, strlen(user));
+            } else {
+                list->user[row] = carry_text(&list->text, &prev_list->text, prev_list->user[r->prev_row], use_remap);
             }
+            list->command[row] = carry_text(&list->text, &prev_list->text, prev_list->command[r->prev_row], use_remap);
+        } else if (!r->enriched) {
+            // stand-ins until the row is wanted: no user, comm as the command
+            list->user[row] = 0;
+            list->command[row] = list->name[row];
+        } else {
+            const char *user = lookup_user_name(r->uid);
+            const char *command = r->command ? arena_str(&workers[r->worker].text, r->command) : r->name;
+            list->user[row] = arena_intern(&list->text, user, strlen(user));
+            list->command[row] = arena_intern(&list->text, command, strlen(command));
         }
 
-        list->count++;
+        if (r->cgroup) {
+            const char *cgroup = arena_str(&workers[r->worker].text, r->cgroup);
+            list->cgroup[row] = arena_intern(&list->text, cgroup, strlen(cgroup));
+        } else if (r->prev_same >= 0) {
+            list->cgroup[row] = carry_text(&list->text, &prev_list->text, prev_list->cgroup[r->prev_same], use_remap);
+        } else {
+            list->cgroup[row] = 0;
+        }
     }
 
-    closedir(proc);
-    sort_process_list(list);
+    refresh_smaps(list);
+    refresh_cgroup_stats(list);
+
+    // snapshot stays in scan order - readers sort/filter it with sort_process_list()
+    build_pid_index(list);
+    list->order_count = 0;
+    list->visible_count = 0;
 }
@@ -2,31 +2,67 @@
 #define PROCESS_LIST_H
 
 #include <sys/types.h>
+#include "arena.h"
+#include "cpu_stats.h"
+#include "proc_events.h"
 
-#define MAX_CMD_LEN 256
+// where per-process numbers come from - see set_collector_backend()
+typedef enum {
+    BACKEND_PROCFS,     // text files under /proc/<pid>
+    BACKEND_TASKSTATS   // taskstats genetlink for CPU time, delays and peak RSS
+} CollectBackend;
 
 typedef enum {
     SORT_PID,
     SORT_MEM,
-    SORT_CPU
+    SORT_CPU,
+    SORT_PSS,
+    SORT_IO             // read + write bytes/s
 } SortMode;
 
+// how far a row's PSS/USS/swap are, they're read on a time budget
+#define SMAPS_NONE   0  // not read yet
+#define SMAPS_OK     1
+#define SMAPS_DENIED 2  // smaps_rollup isn't readable for us (someone else's process)
+
+// same for /proc/<pid>/io, which also needs ptrace rights on the process
+#define IO_NONE   0     // not collected (set_collector_io() off, or a replay)
+#define IO_OK     1
+#define IO_DENIED 2
+
+// one process, materialized from a ProcessList by get_process().
+// strings point into the snapshot, so they live as long as it does
 typedef struct {
     pid_t pid;
     uid_t uid;
-    char name[64];
-    char user[32];
-    char command[MAX_CMD_LEN];
+    const char *name;
+    const char *user;
+    const char *command;
     char state;
     long unsigned int memory_sq;
     float cpu_usage;
     unsigned long long utime;
     unsigned long long stime;
+    unsigned long long starttime; // clock ticks after boot, with pid it identifies a process
     int ppid;
     int threads;
     int priority;
     int nice;
-    char status_name[16];
+    const char *status_name;
+    long unsigned int rss_peak;          // KB
+    unsigned long long cpu_delay;        // ns waiting for a CPU, taskstats backend only
+    unsigned long long io_delay;         // ns waiting on block I/O and swap-in, taskstats only
+    long unsigned int pss;               // KB, RSS with shared pages split between their users
+    long unsigned int uss;               // KB, pages nobody else maps
+    long unsigned int swap;              // KB
+    int smaps_status;                    // SMAPS_*, the three above are only valid with SMAPS_OK
+    unsigned long long smaps_ms;         // CLOCK_MONOTONIC ms they were read at
+    float io_read_rate;                  // bytes/s that hit the block layer
+    float io_write_rate;
+    float io_syscr_rate;                 // read/write syscalls per second
+    float io_syscw_rate;
+    int io_status;                       // IO_*, the rates are 0 unless IO_OK
+    const char *cgroup;                  // cgroup v2 path, "" = unknown
 } ProcessInfo;
 
 typedef struct {
@@ -46,29 +82,140 @@ typedef struct {
     double load_avg[3];
     double disk_read_rate;
     double disk_write_rate;
-    float core_percents[32];
+    float cpu_steal;              // % of all CPU time taken by the hypervisor
+    float cpu_guest;              // % spent running guest VMs
+    const float *core_percents;   // core_count entries, owned by the snapshot this came from
     int core_count;
+    int proc_events;              // 1 = PID set kept current by the proc connector
+    unsigned long exits_seen;     // exits recorded since start
+    ProcExit recent_exits[4];     // newest first
+    int recent_exit_count;
 } SystemInfo;
 
+// the cgroup's own numbers, one entry per distinct cgroup in a snapshot.
+// see set_collector_cgroup_stats()
+typedef struct {
+    unsigned int path;             // offset into the snapshot's text, same as its rows' cgroup
+    unsigned long long usage_usec; // cpu.stat
+    int usage_ok;                  // usage_usec could be read
+    long long memory;              // memory.current in KB, -1 = unreadable
+    float pressure;                // memory.pressure "some" avg10, -1 = unreadable
+} CgroupStats;
+
+// a snapshot of all processes, stored as columns: sorting, filtering and
+// CPU deltas only stream through the numeric arrays they need, and all the
+// text sits in one string arena addressed by offset
 typedef struct {
-    ProcessInfo *processes;
     int count;
     int capacity;
+
+    // hot numeric columns
+    pid_t *pid;
+    uid_t *uid;
+    int *ppid;
+    unsigned long long *utime;
+    unsigned long long *stime;
+    unsigned long long *starttime;
+    long unsigned int *memory_sq;
+    float *cpu_usage;
+    int *threads;
+    int *priority;
+    int *nice;
+    char *state;
+    long unsigned int *rss_peak;
+    unsigned long long *cpu_delay;
+    unsigned long long *io_delay;
+    unsigned char *enriched; // 0 = user/command/peak RSS are stand-ins, see set_collector_wanted()
+    long unsigned int *pss;  // smaps_rollup, KB - read on a budget, see set_collector_smaps_budget()
+    long unsigned int *uss;
+    long unsigned int *swap;
+    unsigned long long *smaps_ms;
+    unsigned char *smaps_status;
+    unsigned long long *io_read;  // /proc/<pid>/io counters, only kept for the next delta
+    unsigned long long *io_write;
+    unsigned long long *io_syscr;
+    unsigned long long *io_syscw;
+    float *io_read_rate;          // per second since the previous snapshot
+    float *io_write_rate;
+    float *io_syscr_rate;
+    float *io_syscw_rate;
+    unsigned char *io_status;
+
+    // cold text, offsets into `text`
+    unsigned int *name;
+    unsigned int *user;
+    unsigned int *command;
+    unsigned int *cgroup;    // e.g. /system.slice/sshd.service, see set_collector_cgroups()
+    StringArena text;
+
+    CgroupStats *cgroup_stats; // empty unless set_collector_cgroup_stats() is on
+    int cgroup_stats_count;
+    int cgroup_stats_capacity;
+
     SortMode sort_mode;
-    unsigned long long total_cpu_time;
-    unsigned long long total_cpu_idle;
+    int incremental;     // reuse cmdline/user from prev_list for PIDs that didn't change
+    CpuStats cpu;        // /proc/stat at the time of this snapshot
+    unsigned long long sample_ms; // CLOCK_MONOTONIC when it was taken
+    unsigned int user_generation; // user_cache_generation() its user names came from
     unsigned long long old_disk_read_sectors;
     unsigned long long old_disk_write_sectors;
-    unsigned long long core_old_totals[32];
-    unsigned long long core_old_idles[32];
     char filter[256];
+    int *pid_index;      // open-addressing PID -> row, -1 = empty
+    int pid_index_size;  // always a power of two
+
+    // reader-side view, built by sort_process_list()/apply_filter().
+    // the sampler never touches these, so the UI can rebuild them on a published snapshot
+    int *order;          // rows in sort order
+    int order_count;
+    int order_capacity;
+    struct SortKey *sort_keys; // scratch for the radix sort, 2 * order_capacity
+    int *visible;        // rows matching filter, in display order
+    int visible_count;
+    int visible_capacity;
+
+    // tree view (tree_mode set): order becomes a depth-first walk of the
+    // process tree, siblings in sort order. all per row, see process_tree.c
+    int tree_mode;
+    int *tree_parent;        // row of the parent, -1 = root
+    int *tree_depth;
+    int *tree_size;          // rows in the subtree, the row itself included
+    float *tree_cpu;         // CPU % of the whole subtree
+    long unsigned int *tree_mem; // RSS of the whole subtree, KB
+    unsigned char *tree_flags;   // TREE_COLLAPSED etc.
+    unsigned long long *tree_guides; // which branch lines to draw left of the row
+    int *tree_scratch;       // child lists and DFS stack, 4 * tree_capacity + 1
+    int tree_capacity;
 } ProcessList;
 
 ProcessList* create_process_list();
 void free_process_list(ProcessList *list);
+int reserve_process_list(ProcessList *list, int n);
 void refresh_process_list(ProcessList *list, ProcessList *prev_list);
+void set_collector_threads(int threads);
+void set_collector_wanted(const pid_t *pids, int count);
+void set_collector_smaps_budget(int budget_us);
+void set_collector_io(int enabled);
+void set_collector_cgroups(int enabled);
+void set_collector_cgroup_stats(int enabled);
+int set_collector_backend(CollectBackend backend);
+void collector_shutdown(void);
 void sort_process_list(ProcessList *list);
+void build_pid_index(ProcessList *list);
+int find_process(const ProcessList *list, pid_t pid);
+void apply_filter(ProcessList *list);
+int find_visible_row(const ProcessList *list, pid_t pid);
+
+ProcessInfo* get_process(const ProcessList *list, int idx, ProcessInfo *out);
+
+// fills `out` with the process on row `row` of the filtered view and returns it
+static inline ProcessInfo* visible_process(const ProcessList *list, int row, ProcessInfo *out) {
+    return get_process(list, list->visible[row], out);
+}
+
+static inline pid_t visible_pid(const ProcessList *list, int row) {
+    return list->pid[list->visible[row]];
+}
 void get_system_info(SystemInfo *info, ProcessList *list, ProcessList *prev_list);
-int compare_processes(const void *a, const void *b);
+void system_info_rescan(void);
 
 #endif
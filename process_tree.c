@@ -0,0 +1,201 @@
+#include <stdlib.h>
+#include <string.h>
+#include "process_tree.h"
+
+// collapsed processes, kept across snapshots. (pid, starttime) so a reused
+// PID doesn't come up collapsed, entries of processes that are gone get dropped
+typedef struct {
+    pid_t pid;
+    unsigned long long starttime;
+} CollapsedEntry;
+
+static CollapsedEntry *collapsed = NULL;
+static int collapsed_count = 0;
+static int collapsed_capacity = 0;
+
+#define GROW_TREE(col, n) do { \
+        void *p_ = realloc((col), sizeof(*(col)) * (n)); \
+        if (!p_) return -1; \
+        (col) = p_; \
+    } while (0)
+
+static int reserve_tree(ProcessList *list, int n) {
+    if (n <= list->tree_capacity) return 0;
+    int cap = list->tree_capacity ? list->tree_capacity : 256;
+    while (cap < n) cap *= 2;
+
+    GROW_TREE(list->tree_parent, cap);
+    GROW_TREE(list->tree_depth, cap);
+    GROW_TREE(list->tree_size, cap);
+    GROW_TREE(list->tree_cpu, cap);
+    GROW_TREE(list->tree_mem, cap);
+    GROW_TREE(list->tree_flags, cap);
+    GROW_TREE(list->tree_guides, cap);
+    GROW_TREE(list->tree_scratch, cap * 4 + 1);
+
+    list->tree_capacity = cap;
+    return 0;
+}
+
+// flags the rows that are collapsed in this snapshot, O(collapsed) lookups
+static void mark_collapsed(ProcessList *list) {
+    memset(list->tree_flags, 0, list->count);
+    for (int k = 0; k < collapsed_count; ) {
+        int row = find_process(list, collapsed[k].pid);
+        if (row < 0 || list->starttime[row] != collapsed[k].starttime) {
+            collapsed[k] = collapsed[--collapsed_count];
+            continue;
+        }
+        list->tree_flags[row] |= TREE_COLLAPSED;
+        k++;
+    }
+}
+
+// turns list->order (sort order) into a depth-first walk of the process tree.
+// every step is linear: parents come from the PID index, children are
+// bucketed by parent in sort order, so siblings stay sorted
+void build_process_tree(ProcessList *list) {
+    int n = list->count;
+    if (reserve_tree(list, n) != 0) {
+        list->tree_mode = 0; // flat list is better than a broken tree
+        return;
+    }
+
+    int *sorted = list->tree_scratch;
+    int *child_start = sorted + n;       // n + 1, children of row r are
+    int *children = child_start + n + 1; // children[child_start[r] .. child_start[r + 1])
+    int *stack = children + n;
+    memcpy(sorted, list->order, sizeof(int) * n);
+
+    memset(child_start, 0, sizeof(int) * (n + 1));
+    for (int i = 0; i < n; i++) {
+        int p = list->ppid[i] > 0 ? find_process(list, list->ppid[i]) : -1;
+        if (p == i) p = -1;
+        list->tree_parent[i] = p;
+        if (p >= 0) child_start[p + 1]++;
+    }
+    for (int i = 0; i < n; i++) child_start[i + 1] += child_start[i];
+
+    // child_start[p] is used as the fill cursor, so afterwards it points at
+    // the end of p's children, which is where p + 1's start
+    for (int k = 0; k < n; k++) {
+        int i = sorted[k];
+        int p = list->tree_parent[i];
+        if (p >= 0) children[child_start[p]++] = i;
+    }
+    for (int i = n; i > 0; i--) child_start[i] = child_start[i - 1];
+    child_start[0] = 0;
+
+    mark_collapsed(list);
+
+    // preorder walk, tree_size doubles as the visited mark until the rollup.
+    // children are pushed in reverse so they come off the stack in sort order
+    for (int i = 0; i < n; i++) list->tree_size[i] = 0;
+    int pos = 0;
+    for (int pass = 0; pass < 2 && pos < n; pass++) {
+        for (int k = 0; k < n; k++) {
+            int r = sorted[k];
+            if (list->tree_size[r]) continue;
+            // the second pass picks up rows that never hang off a root,
+            // a parent/child loop from PID reuse between two /proc reads
+            if (pass == 0 && list->tree_parent[r] >= 0) continue;
+            list->tree_parent[r] = -1;
+            list->tree_depth[r] = 0;
+            list->tree_size[r] = 1;
+
+            int top = 0;
+            stack[top++] = r;
+            while (top > 0) {
+                int i = stack[--top];
+                list->order[pos++] = i;
+                for (int c = child_start[i + 1] - 1; c >= child_start[i]; c--) {
+                    int child = children[c];
+                    if (list->tree_size[child]) continue;
+                    list->tree_size[child] = 1;
+                    list->tree_depth[child] = list->tree_depth[i] + 1;
+                    stack[top++] = child;
+                }
+            }
+        }
+    }
+
+    // subtree totals: children come after their parent in preorder, so a
+    // backwards pass has every subtree finished before it's added upwards
+    for (int i = 0; i < n; i++) {
+        list->tree_size[i] = 1;
+        list->tree_cpu[i] = list->cpu_usage[i];
+        list->tree_mem[i] = list->memory_sq[i];
+    }
+    for (int k = n - 1; k >= 0; k--) {
+        int i = list->order[k];
+        int p = list->tree_parent[i];
+        if (p < 0) continue;
+        list->tree_size[p] += list->tree_size[i];
+        list->tree_cpu[p] += list->tree_cpu[i];
+        list->tree_mem[p] += list->tree_mem[i];
+    }
+}
+
+// fills list->visible from the tree walk: rows that match the filter plus
+// their ancestors, nothing below a collapsed row. TREE_MATCH must be set
+void filter_process_tree(ProcessList *list) {
+    int n = list->count;
+    for (int k = n - 1; k >= 0; k--) {
+        int i = list->order[k];
+        if (!(list->tree_flags[i] & (TREE_MATCH | TREE_SHOWN))) continue;
+        list->tree_flags[i] |= TREE_SHOWN;
+        if (list->tree_parent[i] >= 0) list->tree_flags[list->tree_parent[i]] |= TREE_SHOWN;
+    }
+
+    list->visible_count = 0;
+    for (int k = 0; k < n; ) {
+        int i = list->order[k];
+        if (!(list->tree_flags[i] & TREE_SHOWN)) {
+            k += list->tree_size[i]; // nothing in there matches
+            continue;
+        }
+        list->visible[list->visible_count++] = i;
+        k += (list->tree_flags[i] & TREE_COLLAPSED) ? list->tree_size[i] : 1;
+    }
+
+    // branch lines, from the bottom up: at each depth, is there another
+    // sibling further down before the branch ends
+    unsigned long long more = 0;
+    for (int v = list->visible_count - 1; v >= 0; v--) {
+        int i = list->visible[v];
+        int d = list->tree_depth[i];
+        if (d >= TREE_MAX_GUIDES) {
+            list->tree_guides[i] = more;
+            continue;
+        }
+        unsigned long long below = (2ull << d) - 1; // depths 0..d
+        list->tree_guides[i] = more & below;
+        more = (more & below) | (1ull << d);
+    }
+}
+
+// (un)collapses the subtree under `row` and re-filters
+void collapse_process_tree(ProcessList *list, int row, int collapse) {
+    if (!list->tree_mode || row < 0 || row >= list->count) return;
+
+    int k = 0;
+    while (k < collapsed_count && collapsed[k].pid != list->pid[row]) k++;
+
+    if (collapse && list->tree_size[row] > 1 && k == collapsed_count) {
+        if (collapsed_count == collapsed_capacity) {
+            int cap = collapsed_capacity ? collapsed_capacity * 2 : 16;
+            CollapsedEntry *p = realloc(collapsed, sizeof(CollapsedEntry) * cap);
+            if (!p) return;
+            collapsed = p;
+            collapsed_capacity = cap;
+        }
+        collapsed[collapsed_count].pid = list->pid[row];
+        collapsed[collapsed_count].starttime = list->starttime[row];
+        collapsed_count++;
+        list->tree_flags[row] |= TREE_COLLAPSED;
+    } else if (!collapse && k < collapsed_count) {
+        collapsed[k] = collapsed[--collapsed_count];
+        list->tree_flags[row] &= ~TREE_COLLAPSED;
+    }
+    apply_filter(list);
+}
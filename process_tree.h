@@ -0,0 +1,20 @@
+#ifndef PROCESS_TREE_H
+#define PROCESS_TREE_H
+
+#include "process_list.h"
+
+// parent/child view of a snapshot. built from the PID index in O(n), never
+// by scanning for children, so it can be rebuilt on every refresh
+
+#define TREE_COLLAPSED 0x01  // children hidden, the row shows subtree totals
+#define TREE_MATCH     0x02  // row matches the filter
+#define TREE_SHOWN     0x04  // row or something below it matches the filter
+
+// a row's guides have bit d set when the branch at depth d goes on below it
+#define TREE_MAX_GUIDES 64
+
+void build_process_tree(ProcessList *list);
+void filter_process_tree(ProcessList *list);
+void collapse_process_tree(ProcessList *list, int row, int collapse);
+
+#endif
@@ -0,0 +1,821 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "record.h"
+
+// numbers are stored in host byte order - recordings are meant to be
+// replayed on the same kind of machine they were taken on
+
+#define FILE_MAGIC "PRCSREC1"
+#define FRAME_MAGIC 0x4d415246u // "FRAM"
+#define FORMAT_VERSION 2 // 2: any number of cores, steal/guest
+#define KEYFRAME_INTERVAL 120
+#define FRAME_KEY 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t interval_ms;
+    uint64_t created_ms;
+    uint32_t keyframe_interval;
+    uint32_t reserved;
+} FileHeader;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t length;    // payload bytes, without the padding
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t ts_ms;
+} FrameHeader;
+
+#define PAD8(n) (((n) + 7) & ~(size_t)7)
+
+// which fields of a process row follow in the payload
+enum {
+    F_PPID      = 1 << 0,
+    F_UID       = 1 << 1,
+    F_STATE     = 1 << 2,
+    F_UTIME     = 1 << 3,
+    F_STIME     = 1 << 4,
+    F_STARTTIME = 1 << 5,
+    F_MEMORY    = 1 << 6,
+    F_RSS_PEAK  = 1 << 7,
+    F_CPU       = 1 << 8,
+    F_THREADS   = 1 << 9,
+    F_PRIORITY  = 1 << 10,
+    F_NICE      = 1 << 11,
+    F_NAME      = 1 << 12,
+    F_USER      = 1 << 13,
+    F_COMMAND   = 1 << 14,
+    F_CPU_DELAY = 1 << 15,
+    F_IO_DELAY  = 1 << 16,
+    F_ALL       = (1 << 17) - 1,
+    F_NEW       = 1 << 17,  // deltas are against zero, not the previous row
+};
+
+// one process as the file sees it, strings are ids
+typedef struct {
+    pid_t pid;
+    int ppid;
+    uid_t uid;
+    char state;
+    unsigned long long utime;
+    unsigned long long stime;
+    unsigned long long starttime;
+    unsigned long long memory;
+    unsigned long long rss_peak;
+    unsigned long long cpu_delay;
+    unsigned long long io_delay;
+    unsigned int cpu10;     // cpu_usage in tenths of a percent
+    int threads;
+    int priority;
+    int nice;
+    unsigned int name;
+    unsigned int user;
+    unsigned int command;
+} RecRow;
+
+// the set of processes after some frame, with a PID -> row index
+typedef struct {
+    RecRow *rows;
+    int count;
+    int capacity;
+    int *index;
+    int index_size;
+} RecState;
+
+static unsigned int hash_pid(pid_t pid) {
+    return (unsigned int)pid * 2654435761u;
+}
+
+static void state_reindex(RecState *st) {
+    int want = 64;
+    while (want < st->count * 2) want *= 2;
+    if (want != st->index_size) {
+        int *p = realloc(st->index, sizeof(int) * want);
+        if (!p) {
+            free(st->index);
+            st->index = NULL;
+            st->index_size = 0;
+            return;
+        }
+        st->index = p;
+        st->index_size = want;
+    }
+
+    memset(st->index, -1, sizeof(int) * st->index_size);
+    int mask = st->index_size - 1;
+    for (int i = 0; i < st->count; i++) {
+        int slot = hash_pid(st->rows[i].pid) & mask;
+        while (st->index[slot] != -1) slot = (slot + 1) & mask;
+        st->index[slot] = i;
+    }
+}
+
+static int state_find(const RecState *st, pid_t pid) {
+    if (!st->index) {
+        for (int i = 0; i < st->count; i++) {
+            if (st->rows[i].pid == pid) return i;
+        }
+        return -1;
+    }
+
+    int mask = st->index_size - 1;
+    int slot = hash_pid(pid) & mask;
+    while (st->index[slot] != -1) {
+        if (st->rows[st->index[slot]].pid == pid) return st->index[slot];
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+static RecRow* state_append(RecState *st) {
+    if (st->count >= st->capacity) {
+        int new_cap = st->capacity ? st->capacity * 2 : 256;
+        RecRow *p = realloc(st->rows, sizeof(RecRow) * new_cap);
+        if (!p) return NULL;
+        st->rows = p;
+        st->capacity = new_cap;
+    }
+    return &st->rows[st->count++];
+}
+
+static void state_free(RecState *st) {
+    free(st->rows);
+    free(st->index);
+    memset(st, 0, sizeof(*st));
+}
+
+// --- varint buffer ---
+
+typedef struct {
+    unsigned char *data;
+    size_t used;
+    size_t size;
+} Buf;
+
+static int buf_reserve(Buf *b, size_t n) {
+    if (b->used + n <= b->size) return 0;
+    size_t new_size = b->size ? b->size : 16384;
+    while (b->used + n > new_size) new_size *= 2;
+    unsigned char *p = realloc(b->data, new_size);
+    if (!p) return -1;
+    b->data = p;
+    b->size = new_size;
+    return 0;
+}
+
+// callers reserve first - a varint is at most 10 bytes
+static void put_varint(Buf *b, unsigned long long v) {
+    while (v >= 0x80) {
+        b->data[b->used++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    b->data[b->used++] = (unsigned char)v;
+}
+
+static void put_zigzag(Buf *b, long long v) {
+    put_varint(b, ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63));
+}
+
+static void put_bytes(Buf *b, const void *src, size_t len) {
+    memcpy(b->data + b->used, src, len);
+    b->used += len;
+}
+
+// reading side - p moves through [p, end), every read checks the bounds
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *end;
+    int bad;
+} Reader;
+
+static unsigned long long get_varint(Reader *r) {
+    unsigned long long v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (r->p >= r->end) {
+            r->bad = 1;
+            return 0;
+        }
+        unsigned char c = *r->p++;
+        v |= (unsigned long long)(c & 0x7f) << shift;
+        if (!(c & 0x80)) return v;
+    }
+    r->bad = 1;
+    return 0;
+}
+
+static long long get_zigzag(Reader *r) {
+    unsigned long long v = get_varint(r);
+    return (long long)(v >> 1) ^ -(long long)(v & 1);
+}
+
+static unsigned int tenths(double v) {
+    return v > 0 ? (unsigned int)(v * 10.0 + 0.5) : 0;
+}
+
+static unsigned long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// --- recorder ---
+
+struct Recorder {
+    int fd;
+    unsigned long frames;
+    StringArena strings;   // every string written so far, ids are offsets in here
+    Buf defs;              // strings first seen in the frame being built
+    unsigned int def_count;
+    int broken;            // the arena has strings the file doesn't, see recorder_write()
+    Buf sys;
+    Buf removed;
+    Buf rows;
+    Buf frame;
+    RecState prev;         // what the reader will have after the last frame
+    RecState cur;
+};
+
+Recorder* recorder_open(const char *path, int interval_ms) {
+    Recorder *rec = calloc(1, sizeof(Recorder));
+    if (!rec) return NULL;
+
+    rec->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (rec->fd < 0) {
+        free(rec);
+        return NULL;
+    }
+
+    FileHeader hdr = {0};
+    memcpy(hdr.magic, FILE_MAGIC, sizeof(hdr.magic));
+    hdr.version = FORMAT_VERSION;
+    hdr.interval_ms = interval_ms;
+    hdr.created_ms = now_ms();
+    hdr.keyframe_interval = KEYFRAME_INTERVAL;
+    if (write(rec->fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr)) {
+        close(rec->fd);
+        free(rec);
+        return NULL;
+    }
+    return rec;
+}
+
+void recorder_close(Recorder *rec) {
+    if (!rec) return;
+    close(rec->fd);
+    arena_free(&rec->strings);
+    free(rec->defs.data);
+    free(rec->sys.data);
+    free(rec->removed.data);
+    free(rec->rows.data);
+    free(rec->frame.data);
+    state_free(&rec->prev);
+    state_free(&rec->cur);
+    free(rec);
+}
+
+// id of s, defining it in the current frame the first time it shows up.
+// ids are offsets into the recorder's arena - the reader re-adds the
+// definitions in the same order and ends up with the same offsets, so a
+// string the arena has but the file doesn't breaks every id after it
+static unsigned int intern(Recorder *rec, const char *s) {
+    size_t len = strlen(s);
+    if (len == 0) return 0;
+    if (buf_reserve(&rec->defs, 20 + len) != 0) {
+        rec->broken = 1;
+        return 0;
+    }
+
+    size_t before = rec->strings.used;
+    unsigned int id = arena_intern(&rec->strings, s, len);
+    if (id == 0) {
+        rec->broken = 1; // out of memory, "" would replay as the wrong text
+        return 0;
+    }
+    if (id >= before) {
+        put_varint(&rec->defs, id);
+        put_varint(&rec->defs, len);
+        put_bytes(&rec->defs, s, len);
+        rec->def_count++;
+    }
+    return id;
+}
+
+static int encode_sys(Recorder *rec, const SystemInfo *sys) {
+    unsigned int host = intern(rec, sys->hostname);
+    unsigned int kernel = intern(rec, sys->kernel);
+
+    Buf *b = &rec->sys;
+    b->used = 0;
+    if (buf_reserve(b, (32 + (size_t)sys->core_count) * 10) != 0) return -1;
+    put_varint(b, tenths(sys->cpu_percent));
+    put_varint(b, sys->mem_total);
+    put_varint(b, sys->mem_used);
+    put_varint(b, sys->mem_free);
+    put_varint(b, sys->mem_available);
+    put_varint(b, sys->mem_cached);
+    put_varint(b, sys->swap_total);
+    put_varint(b, sys->swap_free);
+    put_varint(b, (unsigned long long)(sys->uptime * 100.0));
+    put_zigzag(b, (long long)(sys->cpu_temp * 10.0));
+    put_zigzag(b, (long long)(sys->bat_temp * 10.0));
+    put_varint(b, host);
+    put_varint(b, kernel);
+    for (int i = 0; i < 3; i++) put_varint(b, (unsigned long long)(sys->load_avg[i] * 100.0));
+    put_varint(b, tenths(sys->disk_read_rate));
+    put_varint(b, tenths(sys->disk_write_rate));
+    put_varint(b, tenths(sys->cpu_steal));
+    put_varint(b, tenths(sys->cpu_guest));
+    put_varint(b, sys->core_count);
+    for (int i = 0; i < sys->core_count; i++) put_varint(b, tenths(sys->core_percents[i]));
+    return 0;
+}
+
+// fields of r that differ from old (all of them, and F_NEW, if there's no old)
+static unsigned int diff_row(const RecRow *r, const RecRow *old) {
+    if (!old) return F_ALL | F_NEW;
+
+    unsigned int mask = 0;
+    if (r->ppid != old->ppid) mask |= F_PPID;
+    if (r->uid != old->uid) mask |= F_UID;
+    if (r->state != old->state) mask |= F_STATE;
+    if (r->utime != old->utime) mask |= F_UTIME;
+    if (r->stime != old->stime) mask |= F_STIME;
+    if (r->starttime != old->starttime) mask |= F_STARTTIME;
+    if (r->memory != old->memory) mask |= F_MEMORY;
+    if (r->rss_peak != old->rss_peak) mask |= F_RSS_PEAK;
+    if (r->cpu10 != old->cpu10) mask |= F_CPU;
+    if (r->threads != old->threads) mask |= F_THREADS;
+    if (r->priority != old->priority) mask |= F_PRIORITY;
+    if (r->nice != old->nice) mask |= F_NICE;
+    if (r->name != old->name) mask |= F_NAME;
+    if (r->user != old->user) mask |= F_USER;
+    if (r->command != old->command) mask |= F_COMMAND;
+    if (r->cpu_delay != old->cpu_delay) mask |= F_CPU_DELAY;
+    if (r->io_delay != old->io_delay) mask |= F_IO_DELAY;
+    return mask;
+}
+
+static void encode_row(Buf *b, const RecRow *r, const RecRow *old, unsigned int mask) {
+    static const RecRow zero = {0};
+    if (mask & F_NEW) old = &zero;
+
+    put_varint(b, r->pid);
+    put_varint(b, mask);
+    if (mask & F_PPID) put_zigzag(b, r->ppid);
+    if (mask & F_UID) put_varint(b, r->uid);
+    if (mask & F_STATE) b->data[b->used++] = (unsigned char)r->state;
+    if (mask & F_UTIME) put_zigzag(b, (long long)(r->utime - old->utime));
+    if (mask & F_STIME) put_zigzag(b, (long long)(r->stime - old->stime));
+    if (mask & F_STARTTIME) put_varint(b, r->starttime);
+    if (mask & F_MEMORY) put_zigzag(b, (long long)(r->memory - old->memory));
+    if (mask & F_RSS_PEAK) put_zigzag(b, (long long)(r->rss_peak - old->rss_peak));
+    if (mask & F_CPU) put_varint(b, r->cpu10);
+    if (mask & F_THREADS) put_zigzag(b, r->threads);
+    if (mask & F_PRIORITY) put_zigzag(b, r->priority);
+    if (mask & F_NICE) put_zigzag(b, r->nice);
+    if (mask & F_NAME) put_varint(b, r->name);
+    if (mask & F_USER) put_varint(b, r->user);
+    if (mask & F_COMMAND) put_varint(b, r->command);
+    if (mask & F_CPU_DELAY) put_zigzag(b, (long long)(r->cpu_delay - old->cpu_delay));
+    if (mask & F_IO_DELAY) put_zigzag(b, (long long)(r->io_delay - old->io_delay));
+}
+
+static int write_frame(Recorder *rec, const ProcessList *list, const SystemInfo *sys) {
+    int key = rec->frames % KEYFRAME_INTERVAL == 0;
+
+    rec->defs.used = 0;
+    rec->def_count = 0;
+    rec->cur.count = 0;
+    if (encode_sys(rec, sys) != 0) return -1;
+
+    // this frame's rows. text can only change with an exec (new comm),
+    // so for a known process only the name gets looked up again
+    for (int i = 0; i < list->count; i++) {
+        RecRow *r = state_append(&rec->cur);
+        if (!r) return -1;
+
+        int p = state_find(&rec->prev, list->pid[i]);
+        const RecRow *old = p >= 0 && rec->prev.rows[p].starttime == list->starttime[i] ? &rec->prev.rows[p] : NULL;
+
+        r->pid = list->pid[i];
+        r->ppid = list->ppid[i];
+        r->uid = list->uid[i];
+        r->state = list->state[i];
+        r->utime = list->utime[i];
+        r->stime = list->stime[i];
+        r->starttime = list->starttime[i];
+        r->memory = list->memory_sq[i];
+        r->rss_peak = list->rss_peak[i];
+        r->cpu_delay = list->cpu_delay[i];
+        r->io_delay = list->io_delay[i];
+        r->cpu10 = tenths(list->cpu_usage[i]);
+        r->threads = list->threads[i];
+        r->priority = list->priority[i];
+        r->nice = list->nice[i];
+        r->name = intern(rec, arena_str(&list->text, list->name[i]));
+        if (old && old->name == r->name) {
+            r->user = old->user;
+            r->command = old->command;
+        } else {
+            r->user = intern(rec, arena_str(&list->text, list->user[i]));
+            r->command = intern(rec, arena_str(&list->text, list->command[i]));
+        }
+    }
+    if (rec->broken) return -1;
+    state_reindex(&rec->cur);
+
+    // gone since the last frame - a keyframe starts from nothing anyway
+    unsigned int removed = 0;
+    rec->removed.used = 0;
+    if (!key && buf_reserve(&rec->removed, (size_t)rec->prev.count * 10) != 0) return -1;
+    for (int i = 0; !key && i < rec->prev.count; i++) {
+        if (state_find(&rec->cur, rec->prev.rows[i].pid) < 0) {
+            put_varint(&rec->removed, rec->prev.rows[i].pid);
+            removed++;
+        }
+    }
+
+    // new and changed processes
+    unsigned int changed = 0;
+    rec->rows.used = 0;
+    if (buf_reserve(&rec->rows, (size_t)rec->cur.count * 200) != 0) return -1;
+    for (int i = 0; i < rec->cur.count; i++) {
+        const RecRow *r = &rec->cur.rows[i];
+        int p = key ? -1 : state_find(&rec->prev, r->pid);
+        const RecRow *old = p >= 0 && rec->prev.rows[p].starttime == r->starttime ? &rec->prev.rows[p] : NULL;
+
+        unsigned int mask = diff_row(r, old);
+        if (!mask) continue;
+        encode_row(&rec->rows, r, old, mask);
+        changed++;
+    }
+
+    // header, strings, sys info, removed, changed - padded, in one write
+    size_t payload = 30 + rec->defs.used + rec->sys.used + rec->removed.used + rec->rows.used;
+    rec->frame.used = 0;
+    if (buf_reserve(&rec->frame, sizeof(FrameHeader) + PAD8(payload)) != 0) return -1;
+    rec->frame.used = sizeof(FrameHeader);
+    put_varint(&rec->frame, rec->def_count);
+    put_bytes(&rec->frame, rec->defs.data, rec->defs.used);
+    put_bytes(&rec->frame, rec->sys.data, rec->sys.used);
+    put_varint(&rec->frame, removed);
+    put_bytes(&rec->frame, rec->removed.data, rec->removed.used);
+    put_varint(&rec->frame, changed);
+    put_bytes(&rec->frame, rec->rows.data, rec->rows.used);
+
+    FrameHeader hdr = {
+        .magic = FRAME_MAGIC,
+        .length = (uint32_t)(rec->frame.used - sizeof(FrameHeader)),
+        .flags = key ? FRAME_KEY : 0,
+        .ts_ms = now_ms(),
+    };
+    memcpy(rec->frame.data, &hdr, sizeof(hdr));
+    size_t padded = sizeof(FrameHeader) + PAD8(hdr.length);
+    memset(rec->frame.data + rec->frame.used, 0, padded - rec->frame.used);
+
+    if (write(rec->fd, rec->frame.data, padded) != (ssize_t)padded) return -1;
+
+    RecState tmp = rec->prev;
+    rec->prev = rec->cur;
+    rec->cur = tmp;
+    rec->frames++;
+    return 0;
+}
+
+// appends one snapshot, returns -1 if it couldn't be written. a failed
+// frame can leave strings in the arena that never made it to the file,
+// so every frame after it fails too - the file ends at the last good one
+int recorder_write(Recorder *rec, const ProcessList *list, const SystemInfo *sys) {
+    if (rec->broken) return -1;
+    if (write_frame(rec, list, sys) != 0) {
+        rec->broken = 1;
+        return -1;
+    }
+    return 0;
+}
+
+// --- replay ---
+
+typedef struct {
+    size_t offset;      // of the frame header
+    uint64_t ts_ms;
+    int key;
+} FrameRef;
+
+struct Replay {
+    const unsigned char *map;
+    size_t size;
+    FrameRef *frames;
+    int frame_count;
+    StringArena strings;
+    RecState state;
+    int position;       // frame `state` is at, -1 = none
+    SystemInfo sys;     // decoded with it
+    float *cores;       // sys.core_percents points here
+    int cores_cap;
+};
+
+static void skip_defs(Reader *r) {
+    unsigned long long n = get_varint(r);
+    for (unsigned long long i = 0; i < n && !r->bad; i++) {
+        get_varint(r);
+        unsigned long long len = get_varint(r);
+        if ((unsigned long long)(r->end - r->p) < len) {
+            r->bad = 1;
+            return;
+        }
+        r->p += len;
+    }
+}
+
+// one pass over the file: index the frames and collect every string.
+// a truncated last frame (recorder killed mid-write) is just ignored
+static int index_frames(Replay *rp) {
+    int cap = 0;
+    size_t off = sizeof(FileHeader);
+
+    while (off + sizeof(FrameHeader) <= rp->size) {
+        FrameHeader hdr;
+        memcpy(&hdr, rp->map + off, sizeof(hdr));
+        if (hdr.magic != FRAME_MAGIC || hdr.length > rp->size - off - sizeof(hdr)) break;
+
+        Reader r = { rp->map + off + sizeof(hdr), rp->map + off + sizeof(hdr) + hdr.length, 0 };
+        unsigned long long n = get_varint(&r);
+        for (unsigned long long i = 0; i < n && !r.bad; i++) {
+            unsigned long long id = get_varint(&r);
+            unsigned long long len = get_varint(&r);
+            if (r.bad || (unsigned long long)(r.end - r.p) < len) {
+                r.bad = 1;
+                break;
+            }
+            if (arena_add(&rp->strings, (const char *)r.p, len) != id) r.bad = 1;
+            r.p += len;
+        }
+        if (r.bad) break;
+
+        if (rp->frame_count >= cap) {
+            int new_cap = cap ? cap * 2 : 1024;
+            FrameRef *p = realloc(rp->frames, sizeof(FrameRef) * new_cap);
+            if (!p) return -1;
+            rp->frames = p;
+            cap = new_cap;
+        }
+        rp->frames[rp->frame_count++] = (FrameRef){ off, hdr.ts_ms, (hdr.flags & FRAME_KEY) != 0 };
+        off += sizeof(hdr) + PAD8(hdr.length);
+    }
+    return 0;
+}
+
+Replay* replay_open(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(FileHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    FileHeader hdr;
+    memcpy(&hdr, map, sizeof(hdr));
+    Replay *rp = calloc(1, sizeof(Replay));
+    if (!rp || memcmp(hdr.magic, FILE_MAGIC, sizeof(hdr.magic)) != 0 || hdr.version != FORMAT_VERSION) {
+        free(rp);
+        munmap(map, st.st_size);
+        return NULL;
+    }
+
+    rp->map = map;
+    rp->size = st.st_size;
+    rp->position = -1;
+    if (index_frames(rp) != 0) {
+        replay_close(rp);
+        return NULL;
+    }
+    return rp;
+}
+
+void replay_close(Replay *rp) {
+    if (!rp) return;
+    munmap((void *)rp->map, rp->size);
+    free(rp->frames);
+    free(rp->cores);
+    arena_free(&rp->strings);
+    state_free(&rp->state);
+    free(rp);
+}
+
+int replay_frame_count(const Replay *rp) {
+    return rp->frame_count;
+}
+
+unsigned long long replay_frame_time(const Replay *rp, int frame) {
+    if (frame < 0 || frame >= rp->frame_count) return 0;
+    return rp->frames[frame].ts_ms;
+}
+
+// first frame at or after ts_ms (the last one if there's none)
+int replay_find_time(const Replay *rp, unsigned long long ts_ms) {
+    int lo = 0, hi = rp->frame_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (rp->frames[mid].ts_ms < ts_ms) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void decode_sys(Replay *rp, Reader *r, SystemInfo *sys) {
+    memset(sys, 0, sizeof(*sys));
+    sys->cpu_percent = get_varint(r) / 10.0f;
+    sys->mem_total = get_varint(r);
+    sys->mem_used = get_varint(r);
+    sys->mem_free = get_varint(r);
+    sys->mem_available = get_varint(r);
+    sys->mem_cached = get_varint(r);
+    sys->swap_total = get_varint(r);
+    sys->swap_free = get_varint(r);
+    sys->uptime = get_varint(r) / 100.0;
+    sys->cpu_temp = get_zigzag(r) / 10.0;
+    sys->bat_temp = get_zigzag(r) / 10.0;
+
+    unsigned long long host = get_varint(r), kernel = get_varint(r);
+    if (host < rp->strings.used) snprintf(sys->hostname, sizeof(sys->hostname), "%s", arena_str(&rp->strings, host));
+    if (kernel < rp->strings.used) snprintf(sys->kernel, sizeof(sys->kernel), "%s", arena_str(&rp->strings, kernel));
+
+    for (int i = 0; i < 3; i++) sys->load_avg[i] = get_varint(r) / 100.0;
+    sys->disk_read_rate = get_varint(r) / 10.0;
+    sys->disk_write_rate = get_varint(r) / 10.0;
+    sys->cpu_steal = get_varint(r) / 10.0f;
+    sys->cpu_guest = get_varint(r) / 10.0f;
+
+    unsigned long long cores = get_varint(r);
+    if (cores > (unsigned long long)(r->end - r->p)) { // at least a byte each
+        r->bad = 1;
+        return;
+    }
+    if ((int)cores > rp->cores_cap) {
+        float *p = realloc(rp->cores, sizeof(float) * cores);
+        if (!p) {
+            r->bad = 1;
+            return;
+        }
+        rp->cores = p;
+        rp->cores_cap = (int)cores;
+    }
+    for (unsigned long long i = 0; i < cores; i++) rp->cores[i] = get_varint(r) / 10.0f;
+    sys->core_percents = rp->cores;
+    sys->core_count = (int)cores;
+}
+
+static unsigned int get_string_id(Replay *rp, Reader *r) {
+    unsigned long long id = get_varint(r);
+    return id < rp->strings.used ? (unsigned int)id : 0;
+}
+
+// applies frame `frame` on top of rp->state
+static int apply_frame(Replay *rp, int frame, SystemInfo *sys) {
+    const FrameRef *ref = &rp->frames[frame];
+    FrameHeader hdr;
+    memcpy(&hdr, rp->map + ref->offset, sizeof(hdr));
+    Reader r = { rp->map + ref->offset + sizeof(hdr), rp->map + ref->offset + sizeof(hdr) + hdr.length, 0 };
+
+    if (ref->key) rp->state.count = 0;
+    state_reindex(&rp->state);
+
+    skip_defs(&r); // already collected by index_frames()
+    decode_sys(rp, &r, sys);
+
+    // removed processes are marked with pid 0 and squeezed out at the end
+    unsigned long long removed = get_varint(&r);
+    for (unsigned long long i = 0; i < removed && !r.bad; i++) {
+        int row = state_find(&rp->state, (pid_t)get_varint(&r));
+        if (row >= 0) rp->state.rows[row].pid = 0;
+    }
+
+    unsigned long long changed = get_varint(&r);
+    for (unsigned long long i = 0; i < changed && !r.bad; i++) {
+        pid_t pid = (pid_t)get_varint(&r);
+        unsigned int mask = (unsigned int)get_varint(&r);
+
+        int row = state_find(&rp->state, pid);
+        RecRow *p;
+        if (row >= 0) {
+            p = &rp->state.rows[row];
+        } else {
+            p = state_append(&rp->state);
+            if (!p) return -1;
+            mask |= F_NEW;
+        }
+        if (mask & F_NEW) memset(p, 0, sizeof(*p));
+        p->pid = pid;
+
+        if (mask & F_PPID) p->ppid = (int)get_zigzag(&r);
+        if (mask & F_UID) p->uid = (uid_t)get_varint(&r);
+        if (mask & F_STATE) p->state = r.p < r.end ? (char)*r.p++ : '?';
+        if (mask & F_UTIME) p->utime += get_zigzag(&r);
+        if (mask & F_STIME) p->stime += get_zigzag(&r);
+        if (mask & F_STARTTIME) p->starttime = get_varint(&r);
+        if (mask & F_MEMORY) p->memory += get_zigzag(&r);
+        if (mask & F_RSS_PEAK) p->rss_peak += get_zigzag(&r);
+        if (mask & F_CPU) p->cpu10 = (unsigned int)get_varint(&r);
+        if (mask & F_THREADS) p->threads = (int)get_zigzag(&r);
+        if (mask & F_PRIORITY) p->priority = (int)get_zigzag(&r);
+        if (mask & F_NICE) p->nice = (int)get_zigzag(&r);
+        if (mask & F_NAME) p->name = get_string_id(rp, &r);
+        if (mask & F_USER) p->user = get_string_id(rp, &r);
+        if (mask & F_COMMAND) p->command = get_string_id(rp, &r);
+        if (mask & F_CPU_DELAY) p->cpu_delay += get_zigzag(&r);
+        if (mask & F_IO_DELAY) p->io_delay += get_zigzag(&r);
+    }
+
+    int n = 0;
+    for (int i = 0; i < rp->state.count; i++) {
+        if (rp->state.rows[i].pid != 0) rp->state.rows[n++] = rp->state.rows[i];
+    }
+    rp->state.count = n;
+    state_reindex(&rp->state);
+
+    return r.bad ? -1 : 0;
+}
+
+// fills list/sys with frame `frame`. stepping forward decodes one frame,
+// anything else starts over from the closest keyframe before it
+int replay_seek(Replay *rp, int frame, ProcessList *list, SystemInfo *sys) {
+    if (frame < 0 || frame >= rp->frame_count) return -1;
+
+    int key = frame;
+    while (key > 0 && !rp->frames[key].key) key--;
+
+    if (frame != rp->position) {
+        int start = key;
+        if (rp->position >= key && rp->position < frame) start = rp->position + 1;
+        if (start == key) rp->state.count = 0;
+
+        for (int f = start; f <= frame; f++) {
+            if (apply_frame(rp, f, &rp->sys) != 0) {
+                rp->position = -1;
+                return -1;
+            }
+        }
+        rp->position = frame;
+    }
+    *sys = rp->sys;
+
+    // hand it over as a regular snapshot
+    int n = rp->state.count;
+    if (reserve_process_list(list, n) != 0) return -1;
+    arena_reset(&list->text);
+    for (int i = 0; i < n; i++) {
+        const RecRow *p = &rp->state.rows[i];
+        list->pid[i] = p->pid;
+        list->ppid[i] = p->ppid;
+        list->uid[i] = p->uid;
+        list->state[i] = p->state;
+        list->utime[i] = p->utime;
+        list->stime[i] = p->stime;
+        list->starttime[i] = p->starttime;
+        list->memory_sq[i] = p->memory;
+        list->rss_peak[i] = p->rss_peak;
+        list->cpu_delay[i] = p->cpu_delay;
+        list->io_delay[i] = p->io_delay;
+        list->cpu_usage[i] = p->cpu10 / 10.0f;
+        list->threads[i] = p->threads;
+        list->priority[i] = p->priority;
+        list->nice[i] = p->nice;
+        list->enriched[i] = 1; // recordings are always taken with every row complete
+        list->pss[i] = list->uss[i] = list->swap[i] = 0; // not recorded
+        list->smaps_ms[i] = 0;
+        list->smaps_status[i] = SMAPS_NONE;
+        list->io_read_rate[i] = list->io_write_rate[i] = 0;
+        list->io_syscr_rate[i] = list->io_syscw_rate[i] = 0;
+        list->io_status[i] = IO_NONE;
+
+        const char *name = arena_str(&rp->strings, p->name);
+        const char *user = arena_str(&rp->strings, p->user);
+        const char *command = arena_str(&rp->strings, p->command);
+        list->name[i] = arena_intern(&list->text, name, strlen(name));
+        list->user[i] = arena_intern(&list->text, user, strlen(user));
+        list->command[i] = arena_intern(&list->text, command, strlen(command));
+        list->cgroup[i] = 0; // not recorded
+    }
+    list->count = n;
+    build_pid_index(list);
+    list->order_count = 0;
+    list->visible_count = 0;
+    return 0;
+}
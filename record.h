@@ -0,0 +1,33 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "process_list.h"
+
+// recording snapshots to a file and playing them back through the UI.
+//
+// file layout: a 32 byte header, then frames. every frame is a 24 byte
+// header (magic, payload length, flags, timestamp) followed by a varint
+// payload, padded to 8 bytes - so a reader can mmap the file and find every
+// frame by hopping over the headers, without decoding anything.
+//
+// a payload holds the strings first seen in this frame, the system info,
+// then only the processes that changed since the last frame (a bitmask of
+// which fields, numbers as varint deltas) and the ones that went away.
+// every KEYFRAME_INTERVAL frames a keyframe has all processes in full, so a
+// seek only ever decodes up to that many frames.
+
+typedef struct Recorder Recorder;
+typedef struct Replay Replay;
+
+Recorder* recorder_open(const char *path, int interval_ms);
+int recorder_write(Recorder *rec, const ProcessList *list, const SystemInfo *sys);
+void recorder_close(Recorder *rec);
+
+Replay* replay_open(const char *path);
+void replay_close(Replay *rp);
+int replay_frame_count(const Replay *rp);
+unsigned long long replay_frame_time(const Replay *rp, int frame); // ms since epoch
+int replay_find_time(const Replay *rp, unsigned long long ts_ms);
+int replay_seek(Replay *rp, int frame, ProcessList *list, SystemInfo *sys);
+
+#endif
@@ -0,0 +1,269 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "sampler.h"
+#include "proc_events.h"
+
+// triple buffering: the sampler thread fills `back`, the UI reads `front`,
+// and `middle` is the hand-off slot swapped with a single atomic exchange.
+// the FRESH bit in middle says it holds a snapshot the UI hasn't picked up.
+#define SLOT_MASK  3
+#define SLOT_FRESH 4
+
+struct Sampler {
+    Snapshot slots[3];
+    atomic_int middle;
+    int back;            // sampler thread only
+    int front;           // UI thread only
+    Snapshot *prev;      // last published snapshot, used for CPU/disk deltas
+
+    int interval_ms;
+    Recorder *recorder;  // sampler thread only, dropped after a failed write
+    pthread_t thread;
+    pthread_mutex_t lock; // only guards the sleep, never the hand-off
+    pthread_cond_t wake;
+    int refresh_requested;
+    int running;
+
+    // PIDs the UI has on screen, only those get user and command line read.
+    // guarded by lock. a recording needs every row complete, so it's never lazy
+    int lazy;
+    int want_all;
+    pid_t *wanted;
+    int wanted_count;
+    int wanted_cap;
+    int want_threads;    // guarded by lock, the all-threads list is open
+    int want_cgroups;    // guarded by lock, the cgroup list is open
+    unsigned long seq;
+
+    // process exits, sampler thread only - copied into every snapshot
+    ProcExit recent_exits[4];
+    int recent_exit_count;
+    unsigned long exits_seen;
+};
+
+#define RECENT_EXITS 4
+
+// RSS a snapshot saw for an exited process, 0 if it never got sampled
+static unsigned long last_rss(const ProcessList *list, ProcExit *e) {
+    int row = find_process(list, e->pid);
+    if (row < 0) return 0;
+    if (e->starttime == 0) {
+        // its stat was already gone, trust the pid and take what we knew
+        e->starttime = list->starttime[row];
+        e->cpu_ticks = list->utime[row] + list->stime[row];
+        snprintf(e->name, sizeof(e->name), "%s", arena_str(&list->text, list->name[row]));
+    }
+    return list->starttime[row] == e->starttime ? list->memory_sq[row] : 0;
+}
+
+// drains exits from the proc connector. a process has no RSS left by the
+// time it exits, so it gets the last value one of our snapshots saw
+static void collect_exits(Sampler *s, const ProcessList *list, const ProcessList *prev_list) {
+    ProcExit batch[64];
+    int n;
+    while ((n = proc_events_exits(batch, 64)) > 0) {
+        for (int i = 0; i < n; i++) {
+            ProcExit *e = &batch[i];
+            e->rss_kb = last_rss(list, e);
+            if (e->rss_kb == 0 && prev_list) e->rss_kb = last_rss(prev_list, e);
+
+            memmove(&s->recent_exits[1], &s->recent_exits[0], sizeof(ProcExit) * (RECENT_EXITS - 1));
+            s->recent_exits[0] = *e;
+            if (s->recent_exit_count < RECENT_EXITS) s->recent_exit_count++;
+            s->exits_seen++;
+        }
+    }
+}
+
+static void take_sample(Sampler *s) {
+    Snapshot *snap = &s->slots[s->back];
+    ProcessList *prev_list = s->prev ? s->prev->list : NULL;
+
+    pthread_mutex_lock(&s->lock);
+    set_collector_wanted(s->wanted, s->want_all ? -1 : s->wanted_count);
+    set_collector_cgroup_stats(s->want_cgroups);
+    int want_threads = s->want_threads;
+    pthread_mutex_unlock(&s->lock);
+
+    refresh_process_list(snap->list, prev_list);
+    memset(&snap->sys_info, 0, sizeof(snap->sys_info));
+    get_system_info(&snap->sys_info, snap->list, prev_list);
+
+    // every thread on the host is a /proc walk of its own, so it's done
+    // here and published with the rest instead of on the UI thread
+    if (want_threads) thread_list_sample(snap->threads, s->prev ? s->prev->threads : NULL, 0, 0);
+    else snap->threads->valid = 0;
+
+    collect_exits(s, snap->list, prev_list);
+    snap->sys_info.proc_events = proc_events_active();
+    snap->sys_info.exits_seen = s->exits_seen;
+    memcpy(snap->sys_info.recent_exits, s->recent_exits, sizeof(s->recent_exits));
+    snap->sys_info.recent_exit_count = s->recent_exit_count;
+    snap->seq = ++s->seq;
+
+    // a full disk shouldn't take the UI down with it, recording just stops
+    if (s->recorder && recorder_write(s->recorder, snap->list, &snap->sys_info) != 0) {
+        s->recorder = NULL;
+    }
+
+    // publish - whatever was in middle (stale or returned by the UI) becomes the new back
+    int old = atomic_exchange(&s->middle, s->back | SLOT_FRESH);
+    s->prev = snap;
+    s->back = old & SLOT_MASK;
+}
+
+static void* sampler_thread(void *arg) {
+    Sampler *s = arg;
+
+    pthread_mutex_lock(&s->lock);
+    while (s->running) {
+        s->refresh_requested = 0;
+        pthread_mutex_unlock(&s->lock);
+
+        take_sample(s);
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += s->interval_ms / 1000;
+        deadline.tv_nsec += (long)(s->interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        pthread_mutex_lock(&s->lock);
+        while (s->running && !s->refresh_requested) {
+            if (pthread_cond_timedwait(&s->wake, &s->lock, &deadline) != 0) break; // timed out
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+Sampler* sampler_start(int interval_ms, Recorder *rec) {
+    Sampler *s = calloc(1, sizeof(Sampler));
+    if (!s) return NULL;
+
+    for (int i = 0; i < 3; i++) {
+        s->slots[i].list = create_process_list();
+        s->slots[i].threads = calloc(1, sizeof(ThreadList));
+        if (!s->slots[i].list || !s->slots[i].threads) goto fail;
+    }
+
+    s->back = 0;
+    atomic_init(&s->middle, 1);
+    s->front = 2;
+    s->interval_ms = interval_ms;
+    s->recorder = rec;
+    s->lazy = rec == NULL;
+    s->want_all = !s->lazy;
+    s->running = 1;
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->wake, NULL);
+
+    if (pthread_create(&s->thread, NULL, sampler_thread, s) != 0) {
+        pthread_cond_destroy(&s->wake);
+        pthread_mutex_destroy(&s->lock);
+        goto fail;
+    }
+    return s;
+
+fail:
+    for (int i = 0; i < 3; i++) {
+        free_process_list(s->slots[i].list);
+        free(s->slots[i].threads);
+    }
+    free(s);
+    return NULL;
+}
+
+void sampler_stop(Sampler *s) {
+    if (!s) return;
+
+    pthread_mutex_lock(&s->lock);
+    s->running = 0;
+    pthread_cond_signal(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+    pthread_join(s->thread, NULL);
+
+    pthread_cond_destroy(&s->wake);
+    pthread_mutex_destroy(&s->lock);
+    for (int i = 0; i < 3; i++) {
+        free_process_list(s->slots[i].list);
+        if (s->slots[i].threads) thread_list_free(s->slots[i].threads);
+        free(s->slots[i].threads);
+    }
+    free(s->wanted);
+    free(s);
+}
+
+// returns a newer snapshot than the last call, or NULL if there isn't one yet.
+// the previous snapshot returned by this function is given back to the sampler
+const Snapshot* sampler_acquire(Sampler *s) {
+    if (!(atomic_load(&s->middle) & SLOT_FRESH)) return NULL;
+
+    s->front = atomic_exchange(&s->middle, s->front) & SLOT_MASK;
+    return &s->slots[s->front];
+}
+
+// wake the sampler early, e.g. after killing a process
+void sampler_request_refresh(Sampler *s) {
+    pthread_mutex_lock(&s->lock);
+    s->refresh_requested = 1;
+    pthread_cond_signal(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+}
+
+// tells the sampler which processes are on screen (pids = NULL: all of them,
+// e.g. while filtering), from the next refresh on only those get their user
+// and command line read. does nothing while recording
+void sampler_want(Sampler *s, const pid_t *pids, int count) {
+    if (!s->lazy) return;
+
+    pthread_mutex_lock(&s->lock);
+    if (!pids) {
+        s->want_all = 1;
+    } else {
+        if (count > s->wanted_cap) {
+            pid_t *p = realloc(s->wanted, sizeof(pid_t) * count);
+            if (p) {
+                s->wanted = p;
+                s->wanted_cap = count;
+            }
+        }
+        s->want_all = count > s->wanted_cap; // out of memory, read everything
+        if (!s->want_all) {
+            if (count > 0) memcpy(s->wanted, pids, sizeof(pid_t) * count);
+            s->wanted_count = count;
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+}
+
+// turns the all-threads list on or off from the next refresh on. turning
+// it on wakes the sampler, so the list doesn't wait a whole interval
+void sampler_want_threads(Sampler *s, int on) {
+    pthread_mutex_lock(&s->lock);
+    if (on && !s->want_threads) {
+        s->refresh_requested = 1;
+        pthread_cond_signal(&s->wake);
+    }
+    s->want_threads = on;
+    pthread_mutex_unlock(&s->lock);
+}
+
+// same for the cgroups' own files, read with every snapshot while on
+void sampler_want_cgroups(Sampler *s, int on) {
+    pthread_mutex_lock(&s->lock);
+    if (on && !s->want_cgroups) {
+        s->refresh_requested = 1;
+        pthread_cond_signal(&s->wake);
+    }
+    s->want_cgroups = on;
+    pthread_mutex_unlock(&s->lock);
+}
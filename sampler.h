@@ -0,0 +1,27 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "process_list.h"
+#include "record.h"
+#include "thread_view.h"
+
+// one published sample - never modified after the sampler hands it out
+typedef struct {
+    ProcessList *list;
+    SystemInfo sys_info;
+    ThreadList *threads;  // every thread on the host, valid only while wanted
+    unsigned long seq;
+} Snapshot;
+
+typedef struct Sampler Sampler;
+
+// rec, if given, gets every snapshot appended to it (the caller closes it)
+Sampler* sampler_start(int interval_ms, Recorder *rec);
+void sampler_stop(Sampler *sampler);
+const Snapshot* sampler_acquire(Sampler *sampler);
+void sampler_request_refresh(Sampler *sampler);
+void sampler_want(Sampler *sampler, const pid_t *pids, int count);
+void sampler_want_threads(Sampler *sampler, int on);
+void sampler_want_cgroups(Sampler *sampler, int on);
+
+#endif
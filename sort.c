@@ -0,0 +1,43 @@
+#include <string.h>
+#include "sort.h"
+
+// stable LSD radix sort on 64-bit keys, ascending, one byte per pass.
+// passes where every key has the same byte (e.g. the high bytes of a PID)
+// are skipped, so small keys only cost 2-3 passes over the array
+void radix_sort_keys(SortKey *keys, SortKey *scratch, int n) {
+    if (n < 2) return;
+
+    SortKey *src = keys;
+    SortKey *dst = scratch;
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        int counts[256];
+        memset(counts, 0, sizeof(counts));
+        for (int i = 0; i < n; i++) counts[(src[i].key >> shift) & 0xff]++;
+
+        // all keys share this byte, nothing to do
+        if (counts[(src[0].key >> shift) & 0xff] == n) continue;
+
+        int offset = 0;
+        for (int b = 0; b < 256; b++) {
+            int c = counts[b];
+            counts[b] = offset;
+            offset += c;
+        }
+        for (int i = 0; i < n; i++) dst[counts[(src[i].key >> shift) & 0xff]++] = src[i];
+
+        SortKey *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != keys) memcpy(keys, src, sizeof(SortKey) * n);
+}
+
+// maps a float onto an unsigned key with the same ordering, so floats can be radix sorted too
+unsigned long long float_sort_key(float value) {
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits = (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    return bits;
+}
@@ -0,0 +1,13 @@
+#ifndef SORT_H
+#define SORT_H
+
+// (key, index) pairs - sorting these is much cheaper than moving whole ProcessInfo structs
+typedef struct SortKey {
+    unsigned long long key;
+    int index;
+} SortKey;
+
+void radix_sort_keys(SortKey *keys, SortKey *scratch, int n);
+unsigned long long float_sort_key(float value);
+
+#endif
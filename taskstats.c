@@ -0,0 +1,143 @@
+#define _DEFAULT_SOURCE
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/genetlink.h>
+#include <linux/taskstats.h>
+#include <stdatomic.h>
+#include "taskstats.h"
+
+// one request = nlmsghdr + genlmsghdr + a single u32/string attribute.
+// every socket gets its own replies, so each collector thread opens one
+
+typedef struct {
+    struct nlmsghdr nlh;
+    struct genlmsghdr genl;
+    char attrs[64];
+} Request;
+
+static atomic_int family_id = 0; // resolved once, 0 = not yet
+
+static int send_request(int sock, int type, int cmd, int attr, const void *data, int len) {
+    Request req;
+    memset(&req, 0, sizeof(req));
+    req.nlh.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN);
+    req.nlh.nlmsg_type = type;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST;
+    req.genl.cmd = cmd;
+    req.genl.version = 1;
+
+    struct nlattr *na = (struct nlattr *)((char *)&req + req.nlh.nlmsg_len);
+    na->nla_type = attr;
+    na->nla_len = NLA_HDRLEN + len;
+    memcpy((char *)na + NLA_HDRLEN, data, len);
+    req.nlh.nlmsg_len += NLA_ALIGN(na->nla_len);
+
+    return send(sock, &req, req.nlh.nlmsg_len, 0) == (ssize_t)req.nlh.nlmsg_len ? 0 : -1;
+}
+
+// receives one reply, returns its attributes (and their length) or NULL on error
+static struct nlattr* recv_reply(int sock, char *buf, size_t size, int *attr_len) {
+    ssize_t len = recv(sock, buf, size, 0);
+    if (len < (ssize_t)NLMSG_LENGTH(GENL_HDRLEN)) return NULL;
+
+    struct nlmsghdr *nlh = (struct nlmsghdr *)buf;
+    if (nlh->nlmsg_type == NLMSG_ERROR || !NLMSG_OK(nlh, (size_t)len)) return NULL;
+
+    *attr_len = nlh->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+    return (struct nlattr *)((char *)NLMSG_DATA(nlh) + GENL_HDRLEN);
+}
+
+#define NLA_NEXT(na, rem) \
+    ((rem) -= NLA_ALIGN((na)->nla_len), (struct nlattr *)((char *)(na) + NLA_ALIGN((na)->nla_len)))
+#define NLA_FITS(na, rem) ((rem) >= (int)NLA_HDRLEN && (na)->nla_len >= NLA_HDRLEN && (na)->nla_len <= (rem))
+
+static int resolve_family(int sock) {
+    int id = atomic_load(&family_id);
+    if (id > 0) return id;
+
+    if (send_request(sock, GENL_ID_CTRL, CTRL_CMD_GETFAMILY, CTRL_ATTR_FAMILY_NAME,
+                     TASKSTATS_GENL_NAME, sizeof(TASKSTATS_GENL_NAME)) != 0) return -1;
+
+    char buf[1024];
+    int rem;
+    struct nlattr *na = recv_reply(sock, buf, sizeof(buf), &rem);
+    for (; na && NLA_FITS(na, rem); na = NLA_NEXT(na, rem)) {
+        if (na->nla_type == CTRL_ATTR_FAMILY_ID) {
+            unsigned short v;
+            memcpy(&v, (char *)na + NLA_HDRLEN, sizeof(v));
+            atomic_store(&family_id, v);
+            return v;
+        }
+    }
+    return -1;
+}
+
+// opens a taskstats socket, -1 if the family isn't there
+int taskstats_open(void) {
+    int sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+    if (sock < 0) return -1;
+
+    struct sockaddr_nl addr = { .nl_family = AF_NETLINK };
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 || resolve_family(sock) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+void taskstats_close(int sock) {
+    if (sock >= 0) close(sock);
+}
+
+// sends a TASKSTATS_CMD_GET and digs the struct taskstats out of the nested reply
+static int query(int sock, int attr, pid_t pid, struct taskstats *ts) {
+    int family = atomic_load(&family_id);
+    __u32 id = (__u32)pid;
+    if (family <= 0 || send_request(sock, family, TASKSTATS_CMD_GET, attr, &id, sizeof(id)) != 0) return -1;
+
+    char buf[2048];
+    int rem;
+    struct nlattr *na = recv_reply(sock, buf, sizeof(buf), &rem);
+    for (; na && NLA_FITS(na, rem); na = NLA_NEXT(na, rem)) {
+        if (na->nla_type != TASKSTATS_TYPE_AGGR_PID && na->nla_type != TASKSTATS_TYPE_AGGR_TGID) continue;
+
+        int inner_rem = na->nla_len - NLA_HDRLEN;
+        struct nlattr *inner = (struct nlattr *)((char *)na + NLA_HDRLEN);
+        for (; NLA_FITS(inner, inner_rem); inner = NLA_NEXT(inner, inner_rem)) {
+            if (inner->nla_type != TASKSTATS_TYPE_STATS) continue;
+
+            // older kernels send a shorter struct, newer ones a longer one
+            size_t len = inner->nla_len - NLA_HDRLEN;
+            if (len > sizeof(*ts)) len = sizeof(*ts);
+            memset(ts, 0, sizeof(*ts));
+            memcpy(ts, (char *)inner + NLA_HDRLEN, len);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// whole-process numbers: CPU time and delays summed over every thread
+int taskstats_query_tgid(int sock, pid_t tgid, TaskStats *out) {
+    struct taskstats ts;
+    if (query(sock, TASKSTATS_CMD_ATTR_TGID, tgid, &ts) != 0) return -1;
+
+    out->utime_us = ts.ac_utime;
+    out->stime_us = ts.ac_stime;
+    out->cpu_delay_ns = ts.cpu_delay_total;
+    out->io_delay_ns = ts.blkio_delay_total + ts.swapin_delay_total;
+    return 0;
+}
+
+// leader-thread numbers - the accounting fields (uid, RSS high-water)
+// only come with a per-task query
+int taskstats_query_pid(int sock, pid_t pid, TaskStats *out) {
+    struct taskstats ts;
+    if (query(sock, TASKSTATS_CMD_ATTR_PID, pid, &ts) != 0) return -1;
+
+    out->uid = ts.ac_uid;
+    out->rss_peak_kb = ts.hiwater_rss;
+    return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef TASKSTATS_H
+#define TASKSTATS_H
+
+#include <sys/types.h>
+
+// per-process numbers from the kernel's taskstats genetlink family -
+// binary, so nothing to tokenize. needs CAP_NET_ADMIN.
+
+typedef struct {
+    unsigned long long utime_us;      // CPU time, summed over the thread group
+    unsigned long long stime_us;
+    unsigned long long cpu_delay_ns;  // time spent runnable but waiting for a CPU
+    unsigned long long io_delay_ns;   // time spent waiting on block I/O
+    unsigned long rss_peak_kb;        // leader's RSS high-water mark (PID query only)
+    uid_t uid;                        // PID query only
+} TaskStats;
+
+int taskstats_open(void);
+void taskstats_close(int sock);
+int taskstats_query_tgid(int sock, pid_t tgid, TaskStats *out);
+int taskstats_query_pid(int sock, pid_t pid, TaskStats *out);
+
+#endif
@@ -0,0 +1,342 @@
+#define _POSIX_C_SOURCE 200809L
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sort.h"
+#include "thread_view.h"
+
+static int active = 0;
+static pid_t view_pid = 0;
+
+// the drill-down samples on a thread of its own, a process can have
+// thousands of threads. handed over like the sampler's snapshots: the
+// thread fills `back`, the UI reads `front`, `middle` is swapped between
+// them with one atomic exchange and FRESH says the UI hasn't seen it yet
+#define SLOT_MASK  3
+#define SLOT_FRESH 4
+
+static struct {
+    ThreadList slots[3];
+    atomic_int middle;
+    int back;                    // sampling thread only
+    int front;                   // UI thread only
+    pid_t pid;
+    unsigned long long starttime;
+    atomic_int gone;             // set before the last (empty) list is published
+    pthread_t thread;
+    pthread_mutex_t lock;        // only guards the sleep
+    pthread_cond_t wake;
+    int running;
+    int started;
+} drill = { .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER };
+
+static const ThreadList *all_threads = NULL; // the sampler's, pid 0
+
+static unsigned long long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int is_numeric(const char *s) {
+    if (!*s) return 0;
+    for (; *s; s++) {
+        if (*s < '0' || *s > '9') return 0;
+    }
+    return 1;
+}
+
+#define GROW_THREADS(col, n) do { \
+        void *p_ = realloc((col), sizeof(*(col)) * (n)); \
+        if (!p_) return -1; \
+        (col) = p_; \
+    } while (0)
+
+static int reserve_threads(ThreadList *tl, int n) {
+    if (n <= tl->capacity) return 0;
+    int cap = tl->capacity ? tl->capacity : 64;
+    while (cap < n) cap *= 2;
+
+    GROW_THREADS(tl->raw, cap);
+    GROW_THREADS(tl->threads, cap);
+    GROW_THREADS(tl->order, cap);
+    GROW_THREADS(tl->keys, cap * 2);
+
+    tl->capacity = cap;
+    return 0;
+}
+
+// /proc/<pid>/task/<tid>/stat - the per-thread one. /proc/<tid>/stat would
+// give the totals of the whole process
+static int read_thread(int task_fd, const char *tid, pid_t pid, ThreadInfo *t,
+                       unsigned long long *starttime) {
+    char path[64], buf[1024];
+    snprintf(path, sizeof(path), "%s/stat", tid);
+    int fd = openat(task_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t len = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (len <= 0) return -1;
+    buf[len] = '\0';
+
+    // comm can have spaces and parens in it, it ends at the last ')'
+    char *open = strchr(buf, '(');
+    char *close_paren = strrchr(buf, ')');
+    if (!open || !close_paren || close_paren < open || close_paren[1] == '\0') return -1;
+    size_t name_len = close_paren - open - 1;
+    if (name_len >= sizeof(t->name)) name_len = sizeof(t->name) - 1;
+    memcpy(t->name, open + 1, name_len);
+    t->name[name_len] = '\0';
+
+    t->tid = atoi(tid);
+    t->pid = pid;
+    t->ticks = 0;
+    t->processor = -1;
+    t->cpu_usage = 0.0f;
+
+    // fields are numbered like proc(5): 3 is the state, right after comm
+    const char *p = close_paren + 2;
+    t->state = *p;
+    for (int field = 3; *p; field++) {
+        if (field == 14 || field == 15) t->ticks += strtoull(p, NULL, 10); // utime, stime
+        else if (field == 22 && starttime) *starttime = strtoull(p, NULL, 10);
+        else if (field == 39) {
+            t->processor = atoi(p);
+            break;
+        }
+        while (*p && *p != ' ') p++;
+        while (*p == ' ') p++;
+    }
+    return 0;
+}
+
+// appends every thread of `pid` to tl->raw. -1 if the process is gone, or if
+// `starttime` is given and the PID belongs to someone else by now - that's
+// checked on the leader before anything is added
+static int read_process(ThreadList *tl, pid_t pid, unsigned long long starttime) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+    int task_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (task_fd < 0) return -1;
+
+    if (starttime) {
+        ThreadInfo leader;
+        unsigned long long leader_start = 0;
+        char tid[16];
+        snprintf(tid, sizeof(tid), "%d", pid);
+        if (read_thread(task_fd, tid, pid, &leader, &leader_start) != 0 || leader_start != starttime) {
+            close(task_fd);
+            return -1;
+        }
+    }
+
+    DIR *dir = fdopendir(task_fd);
+    if (!dir) {
+        close(task_fd);
+        return -1;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir))) {
+        if (!is_numeric(entry->d_name)) continue;
+        if (reserve_threads(tl, tl->raw_count + 1) != 0) break; // out of memory, show what we have
+        if (read_thread(task_fd, entry->d_name, pid, &tl->raw[tl->raw_count], NULL) != 0) {
+            continue; // exited between readdir and open
+        }
+        tl->raw_count++;
+    }
+    closedir(dir);
+    return 0;
+}
+
+int thread_list_sample(ThreadList *tl, const ThreadList *prev, pid_t pid, unsigned long long starttime) {
+    int rc = 0;
+    tl->sample_ms = monotonic_ms();
+    tl->raw_count = 0;
+    tl->count = 0;
+    tl->valid = 1;
+
+    if (pid > 0) {
+        if (read_process(tl, pid, starttime) != 0) {
+            tl->raw_count = 0;
+            rc = -1;
+        }
+    } else {
+        DIR *dir = opendir("/proc");
+        if (dir) {
+            struct dirent *entry;
+            while ((entry = readdir(dir))) {
+                if (is_numeric(entry->d_name)) read_process(tl, atoi(entry->d_name), 0);
+            }
+            closedir(dir);
+        }
+    }
+
+    int n = tl->raw_count;
+    SortKey *scratch = tl->keys + tl->capacity;
+    for (int i = 0; i < n; i++) {
+        tl->keys[i].key = (unsigned long long)tl->raw[i].tid;
+        tl->keys[i].index = i;
+    }
+    radix_sort_keys(tl->keys, scratch, n);
+    for (int i = 0; i < n; i++) tl->threads[i] = tl->raw[tl->keys[i].index];
+    tl->count = n;
+
+    // CPU % of one core: ticks used over ticks that went by. both sides are
+    // in TID order, so it's one merge pass
+    long clk_tck = sysconf(_SC_CLK_TCK);
+    if (clk_tck <= 0) clk_tck = 100;
+    double elapsed_ticks = 0.0;
+    if (prev && prev->valid && tl->sample_ms > prev->sample_ms) {
+        elapsed_ticks = (tl->sample_ms - prev->sample_ms) / 1000.0 * clk_tck;
+    }
+    for (int i = 0, k = 0; i < n && elapsed_ticks > 0; i++) {
+        while (k < prev->count && prev->threads[k].tid < tl->threads[i].tid) k++;
+        if (k == prev->count) break;
+        const ThreadInfo *old = &prev->threads[k];
+        if (old->tid != tl->threads[i].tid || old->ticks > tl->threads[i].ticks) continue;
+        tl->threads[i].cpu_usage = (float)((tl->threads[i].ticks - old->ticks) / elapsed_ticks * 100.0);
+    }
+
+    for (int i = 0; i < n; i++) {
+        tl->keys[i].key = ~float_sort_key(tl->threads[i].cpu_usage) & 0xffffffffull;
+        tl->keys[i].index = i;
+    }
+    radix_sort_keys(tl->keys, scratch, n);
+    for (int i = 0; i < n; i++) tl->order[i] = tl->keys[i].index;
+    return rc;
+}
+
+void thread_list_free(ThreadList *tl) {
+    free(tl->raw);
+    free(tl->threads);
+    free(tl->order);
+    free(tl->keys);
+    memset(tl, 0, sizeof(*tl));
+}
+
+// sleeps until `ms` after `since`, 0 = told to stop
+static int drill_sleep(unsigned long long since, int ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline); // the condvar's clock
+    unsigned long long now = monotonic_ms();
+    long wait_ms = since + ms > now ? (long)(since + ms - now) : 0;
+    deadline.tv_sec += wait_ms / 1000;
+    deadline.tv_nsec += (wait_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&drill.lock);
+    while (drill.running) {
+        if (pthread_cond_timedwait(&drill.wake, &drill.lock, &deadline) != 0) break; // timed out
+    }
+    int running = drill.running;
+    pthread_mutex_unlock(&drill.lock);
+    return running;
+}
+
+static void* drill_thread(void *arg) {
+    (void)arg;
+    const ThreadList *prev = NULL;
+    // the first sample has nothing to compare with, take the second one
+    // soon so the rates don't wait for a whole interval
+    int interval_ms = 100;
+    for (;;) {
+        ThreadList *tl = &drill.slots[drill.back];
+        int rc = thread_list_sample(tl, prev, drill.pid, drill.starttime);
+        if (rc != 0) atomic_store(&drill.gone, 1);
+
+        int old = atomic_exchange(&drill.middle, drill.back | SLOT_FRESH);
+        prev = tl;
+        drill.back = old & SLOT_MASK;
+
+        if (rc != 0 || !drill_sleep(tl->sample_ms, interval_ms)) break;
+        interval_ms = THREAD_VIEW_INTERVAL_MS;
+    }
+    return NULL;
+}
+
+static void drill_stop(void) {
+    if (!drill.started) return;
+    pthread_mutex_lock(&drill.lock);
+    drill.running = 0;
+    pthread_cond_signal(&drill.wake);
+    pthread_mutex_unlock(&drill.lock);
+    pthread_join(drill.thread, NULL);
+    drill.started = 0;
+}
+
+void thread_view_open(pid_t pid, unsigned long long starttime) {
+    drill_stop();
+    active = 1;
+    view_pid = pid;
+    if (pid <= 0) return; // the sampler takes it from here, see main.c
+
+    for (int i = 0; i < 3; i++) drill.slots[i].valid = 0;
+    drill.back = 0;
+    atomic_init(&drill.middle, 1);
+    drill.front = 2;
+    drill.pid = pid;
+    drill.starttime = starttime;
+    atomic_init(&drill.gone, 0);
+    drill.running = 1;
+    if (pthread_create(&drill.thread, NULL, drill_thread, NULL) != 0) {
+        // no thread, no list - say so instead of waiting forever
+        atomic_store(&drill.gone, 1);
+        return;
+    }
+    drill.started = 1;
+}
+
+void thread_view_close(void) {
+    active = 0;
+    drill_stop();
+    for (int i = 0; i < 3; i++) thread_list_free(&drill.slots[i]);
+}
+
+int thread_view_active(void) {
+    return active;
+}
+
+pid_t thread_view_pid(void) {
+    return view_pid;
+}
+
+// picks up the drill-down's newest list, never blocks
+int thread_view_tick(void) {
+    if (!active || view_pid <= 0) return 0;
+    if (!(atomic_load(&drill.middle) & SLOT_FRESH)) return 0;
+    drill.front = atomic_exchange(&drill.middle, drill.front) & SLOT_MASK;
+    return 1;
+}
+
+void thread_view_set_all(const ThreadList *tl) {
+    all_threads = tl;
+}
+
+static const ThreadList *shown(void) {
+    if (view_pid > 0) return drill.slots[drill.front].valid ? &drill.slots[drill.front] : NULL;
+    return all_threads && all_threads->valid ? all_threads : NULL;
+}
+
+int thread_view_count(void) {
+    const ThreadList *tl = shown();
+    return active && tl ? tl->count : 0;
+}
+
+const ThreadInfo *thread_view_row(int i) {
+    const ThreadList *tl = shown();
+    return &tl->threads[tl->order[i]];
+}
+
+int thread_view_gone(void) {
+    return view_pid > 0 && atomic_load(&drill.gone);
+}
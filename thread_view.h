@@ -0,0 +1,62 @@
+#ifndef THREAD_VIEW_H
+#define THREAD_VIEW_H
+
+#include <sys/types.h>
+
+// threads of one process (or of every process) from /proc/<pid>/task,
+// with their own CPU rates. nothing of it is read on the UI thread: one
+// process is sampled several times a second by a thread of its own while
+// the list is open, every thread on the host comes with the sampler's
+// snapshots (sampler_want_threads)
+
+#define THREAD_VIEW_INTERVAL_MS 250      // drilled into one process
+
+typedef struct {
+    pid_t tid;
+    pid_t pid;                 // process the thread belongs to
+    char name[16];             // comm, threads can name themselves
+    char state;
+    int processor;             // CPU it last ran on
+    unsigned long long ticks;  // utime + stime
+    float cpu_usage;           // % of one core since the last sample
+} ThreadInfo;
+
+// one sample. each has its own scratch, so the sampler and the drill-down
+// thread can fill theirs at the same time
+typedef struct {
+    ThreadInfo *threads;       // sorted by TID, matched against the last sample
+    int *order;                // rows of `threads`, busiest first
+    int count;
+    int valid;                 // 0 = nobody asked for this one
+    unsigned long long sample_ms; // CLOCK_MONOTONIC
+    ThreadInfo *raw;           // as read, directory order
+    int raw_count;
+    struct SortKey *keys;      // 2 * capacity, second half is radix scratch
+    int capacity;
+} ThreadList;
+
+// pid 0 = every thread on the host. prev (can be NULL) is the sample the
+// CPU rates are worked out against. -1 if the process is gone, or the PID
+// isn't `starttime`'s process anymore
+int thread_list_sample(ThreadList *tl, const ThreadList *prev, pid_t pid, unsigned long long starttime);
+void thread_list_free(ThreadList *tl);
+
+// pid 0 = every thread on the host. starttime tells a reused PID apart
+void thread_view_open(pid_t pid, unsigned long long starttime);
+void thread_view_close(void);
+int thread_view_active(void);
+pid_t thread_view_pid(void);
+
+// picks up the drilled-into process's newest sample, never blocks.
+// 1 = there's something new to draw
+int thread_view_tick(void);
+
+// the sampler's all-threads list of the snapshot on screen
+void thread_view_set_all(const ThreadList *tl);
+
+// busiest first. 0 rows and thread_view_gone() = the process exited
+int thread_view_count(void);
+const ThreadInfo *thread_view_row(int i);
+int thread_view_gone(void);
+
+#endif
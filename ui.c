@@ -1,10 +1,18 @@
 #define _POSIX_C_SOURCE 200809L
 #include <ncurses.h>
+#include <fcntl.h>
+#include <time.h>
 #include <string.h>
 #include <stdlib.h>
 #include <signal.h>
+#include <unistd.h>
 #include "ui.h"
 #include "process_list.h"
+#include "process_tree.h"
+#include "history.h"
+#include "cpu_topology.h"
+#include "thread_view.h"
+#include "cgroup_view.h"
 
 // Theme enum - added more themes because why not
 typedef enum {
@@ -24,7 +32,9 @@ typedef enum {
 static Theme current_theme = THEME_DEFAULT;
 static int is_searching = 0;
 static int pending_g = 0;  // for vim-style 'gg' navigation
-static int show_cpu_cores = 0;
+// what the CPU panel shows, '1' cycles through them
+enum { CPU_VIEW_TOTAL, CPU_VIEW_BARS, CPU_VIEW_HEATMAP, CPU_VIEW_COUNT };
+static int cpu_view = CPU_VIEW_TOTAL;
 static int show_process_details = 0;
 static int mem_in_mb = 0;          // 0 for KB, 1 for MB
 static int show_help = 0;          // for help menu popup
@@ -32,6 +42,56 @@ static int show_kill_confirm = 0;  // for kill confirmation popup
 static pid_t kill_confirm_pid = 0;  // PID to kill if confirmed
 static char kill_confirm_name[64]; // Name of process to kill if confirmed
 static int kill_confirm_selected = 0; // 0 for Yes, 1 for No
+static char replay_status[160];    // replaying a recording when set, shown in the status bar
+static int show_smaps = 0;         // PSS/USS/swap columns, when the collector reads them
+static int show_io = 0;            // I/O rate columns in place of PSS/USS/swap
+static int thread_scroll = 0;      // first row of the thread list on screen
+static char thread_title[64];      // whose threads, for the status bar
+static int cgroup_scroll = 0;      // same for the cgroup list
+
+// the optional columns between MEM and CPU, one group at a time
+enum { EXTRA_NONE, EXTRA_SMAPS, EXTRA_IO };
+
+#define EXTRA_COLS_MIN_WIDTH 150   // narrower than this they'd eat the command column
+#define SMAPS_STALE_MS 5000        // older values get a ~
+
+// damage tracking: the screen is only wiped when something in `Layout`
+// changed, otherwise every process row is compared against what's already
+// on screen and left alone if it's the same - ncurses then skips those lines
+// entirely when it works out what to send to the terminal
+typedef struct {
+    int height, width;
+    int theme;
+    int cpu_view;
+    int show_process_details;
+    int mem_in_mb;
+    int show_help;
+    int show_kill_confirm;
+    int extra_cols;
+    int threads;        // 0 = process list, 1 = one process' threads, 2 = all threads
+    int cgroups;        // cgroup list instead of processes
+    char hostname[64];  // only change after system_info_rescan()
+    char kernel[64];
+} Layout;
+
+#define ROW_CACHE_MAX 512
+
+typedef struct {
+    int valid;
+    int selected;
+    char line[512];     // as rendered, "" = blank row
+} RowCache;
+
+static Layout last_layout;
+static int layout_valid = 0;
+static RowCache row_cache[ROW_CACHE_MAX];
+
+// render stats, shown in the status bar with ui_show_stats()
+static int show_stats = 0;
+static int io_fd = -1;                     // /proc/thread-self/io of the UI thread
+static unsigned long long frame_bytes = 0; // written by the last refresh()
+static long frame_us = 0;                  // draw_ui() + refresh() of the last frame
+static int frame_rows = 0;                 // process rows repainted in the last frame
 
 // color pair macros - each theme gets 4 pairs
 #define PAIR_HEADER(t) (1 + (t)*4)
@@ -121,12 +181,52 @@ void init_ui() {
 
 void cleanup_ui() {
     endwin();
+    if (io_fd >= 0) close(io_fd);
+    io_fd = -1;
+}
+
+// bytes this thread has passed to write() so far, 0 if we can't tell.
+// ncurses writes straight to the terminal fd, so this is what it sent
+static unsigned long long written_bytes(void) {
+    if (io_fd < 0) io_fd = open("/proc/thread-self/io", O_RDONLY | O_CLOEXEC);
+    if (io_fd < 0) return 0;
+
+    char buf[512];
+    ssize_t n = pread(io_fd, buf, sizeof(buf) - 1, 0);
+    if (n <= 0) return 0;
+    buf[n] = '\0';
+    char *p = strstr(buf, "wchar:");
+    return p ? strtoull(p + 6, NULL, 10) : 0;
+}
+
+void ui_show_stats(int enabled) {
+    show_stats = enabled;
+}
+
+void ui_show_smaps(int enabled) {
+    show_smaps = enabled;
 }
 
 void toggle_theme() {
     current_theme = (current_theme + 1) % THEME_COUNT;
 }
 
+// switches the UI into replay mode (status != NULL) - the status bar shows
+// `status` instead of the usual line, and killing is off since the
+// processes on screen may be long gone
+void ui_set_replay(const char *status) {
+    if (status) {
+        snprintf(replay_status, sizeof(replay_status), "%s", status);
+    } else {
+        replay_status[0] = '\0';
+    }
+}
+
+// true while a popup or the search prompt wants every key
+int ui_input_captured(void) {
+    return is_searching || show_kill_confirm || show_help;
+}
+
 void reset_search_mode() {
     is_searching = 0;
 }
@@ -158,6 +258,12 @@ void draw_bar(int y, int x, int width, float percent, int color_pair_unused) {
     mvprintw(y, x + width - 1, "]");
 }
 
+// blanks a rectangle, without touching anything around it
+static void clear_area(int y, int x, int h, int w) {
+    if (w <= 0) return;
+    for (int i = 0; i < h; i++) mvhline(y + i, x, ' ', w);
+}
+
 void draw_box(int y, int x, int h, int w, int color_pair, const char *title) {
     attron(COLOR_PAIR(color_pair));
     
@@ -265,7 +371,7 @@ void draw_help_menu() {
     int height, width;
     getmaxyx(stdscr, height, width);
     
-    int popup_h = 16;
+    int popup_h = 18;
     int popup_w = 70; // Wider to accommodate two columns
     int popup_y = (height - popup_h) / 2;
     int popup_x = (width - popup_w) / 2;
@@ -293,6 +399,11 @@ void draw_help_menu() {
     mvprintw(curr_y++, col1_x, "gg      : Jump to Top");
     mvprintw(curr_y++, col1_x, "G       : Jump to Bottom");
     mvprintw(curr_y++, col1_x, "h, l    : Select Button");
+    mvprintw(curr_y++, col1_x, "T       : Tree View");
+    mvprintw(curr_y++, col1_x, "-, +    : Collapse/Expand");
+    mvprintw(curr_y++, col1_x, "d       : Threads of Process");
+    mvprintw(curr_y++, col1_x, "D       : All Threads");
+    mvprintw(curr_y++, col1_x, "C       : Cgroups");
     
     // Column 2: Actions
     attron(A_BOLD | COLOR_PAIR(PAIR_HEADER(current_theme)));
@@ -305,8 +416,11 @@ void draw_help_menu() {
     mvprintw(curr_y++, col2_x, "Enter : Toggle Details");
     mvprintw(curr_y++, col2_x, "M     : Memory unit");
     mvprintw(curr_y++, col2_x, "t     : Cycle Theme");
-    mvprintw(curr_y++, col2_x, "1     : CPU Core View");
-    mvprintw(curr_y++, col2_x, "c,m,p : Sort Mode");
+    mvprintw(curr_y++, col2_x, "1     : CPU Cores/Heatmap");
+    mvprintw(curr_y++, col2_x, "c,m,p : Sort CPU/Mem/PID");
+    mvprintw(curr_y++, col2_x, "P, i  : Sort PSS/IO");
+    mvprintw(curr_y++, col2_x, "I     : PSS/IO Columns");
+    mvprintw(curr_y++, col2_x, "R     : Rescan Sensors/Host");
     mvprintw(curr_y++, col2_x, "H     : Toggle Help");
     mvprintw(curr_y++, col2_x, "q,ESC : Quit/Back");
     
@@ -316,27 +430,303 @@ void draw_help_menu() {
 }
 
 
+// one row of history, newest sample at the right edge
+static void draw_sparkline(int y, int x, int w, const float *v, int n, float lo, float hi) {
+    static const char ramp[] = "_.,-=+*#";
+    if (n > w) {
+        v += n - w;
+        n = w;
+    }
+    for (int i = 0; i < n; i++) {
+        int level = 0;
+        if (hi > lo) level = (int)((v[i] - lo) / (hi - lo) * 7.0f + 0.5f);
+        if (level < 0) level = 0;
+        if (level > 7) level = 7;
+        mvaddch(y, x + w - n + i, ramp[level]);
+    }
+}
+
+// one PSS/USS/swap cell: "-" not read yet, "?" not readable for us,
+// a ~ after the number when the collector hasn't got back to it lately
+static void format_smaps(char *buf, size_t size, long unsigned int kb, const ProcessInfo *p,
+                         unsigned long long now_ms) {
+    if (p->smaps_status == SMAPS_NONE) {
+        snprintf(buf, size, "-");
+        return;
+    }
+    if (p->smaps_status == SMAPS_DENIED) {
+        snprintf(buf, size, "?");
+        return;
+    }
+    const char *stale = now_ms - p->smaps_ms > SMAPS_STALE_MS ? "~" : "";
+    if (mem_in_mb) snprintf(buf, size, "%.1f%s", kb / 1024.0f, stale);
+    else snprintf(buf, size, "%lu%s", kb, stale);
+}
+
+// bytes (or syscalls) per second, "-" not collected, "?" not readable for us
+static void format_rate(char *buf, size_t size, float rate, int io_status) {
+    if (io_status == IO_NONE) snprintf(buf, size, "-");
+    else if (io_status == IO_DENIED) snprintf(buf, size, "?");
+    else if (rate >= 1024.0f * 1024.0f * 1024.0f) snprintf(buf, size, "%.1fG", rate / (1024.0f * 1024.0f * 1024.0f));
+    else if (rate >= 1024.0f * 1024.0f) snprintf(buf, size, "%.1fM", rate / (1024.0f * 1024.0f));
+    else if (rate >= 1024.0f) snprintf(buf, size, "%.1fK", rate / 1024.0f);
+    else snprintf(buf, size, "%.0f", rate);
+}
+
+static unsigned long long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// repaints list row `y` unless it already shows `line`
+static void draw_row(int y, RowCache *cached, const char *line, int selected, int w) {
+    if (cached->valid && cached->selected == selected && strcmp(cached->line, line) == 0) {
+        return; // already on screen
+    }
+    cached->valid = 1;
+    cached->selected = selected;
+    snprintf(cached->line, sizeof(cached->line), "%s", line);
+    frame_rows++;
+
+    if (selected) {
+        attron(COLOR_PAIR(PAIR_SELECT(current_theme)));
+    }
+    mvhline(y, 0, ' ', w);
+    mvaddnstr(y, 0, line, w);
+
+    if (selected) {
+         mvchgat(y, 0, w, A_NORMAL, PAIR_SELECT(current_theme), NULL);
+         attroff(COLOR_PAIR(PAIR_SELECT(current_theme)));
+    }
+}
+
+static void format_thread_row(char *buf, size_t size, const ThreadInfo *t) {
+    static long clk_tck = 0;
+    if (!clk_tck) clk_tck = sysconf(_SC_CLK_TCK);
+    char core[16] = "-";
+    if (t->processor >= 0) snprintf(core, sizeof(core), "%d", t->processor);
+    snprintf(buf, size, " %-8d %-8d %-16s %-10.1f %-10c %-10s %.2fs",
+             t->tid, t->pid, t->name, t->cpu_usage, t->state, core, (double)t->ticks / clk_tck);
+}
+
+// "-" for what the cgroup doesn't have (memory.current needs the memory
+// controller, the root has neither it nor the first cpu.stat delta yet)
+static void format_cgroup_row(char *buf, size_t size, const CgroupInfo *g) {
+    char cpu[16] = "-", rss[24], mem[24] = "-", psi[16] = "-";
+    if (g->cpu >= 0) snprintf(cpu, sizeof(cpu), "%.1f", g->cpu);
+    if (mem_in_mb) snprintf(rss, sizeof(rss), "%.1f", g->rss / 1024.0f);
+    else snprintf(rss, sizeof(rss), "%lu", g->rss);
+    if (g->memory >= 0) {
+        if (mem_in_mb) snprintf(mem, sizeof(mem), "%.1f", g->memory / 1024.0f);
+        else snprintf(mem, sizeof(mem), "%lld", g->memory);
+    }
+    if (g->pressure >= 0) snprintf(psi, sizeof(psi), "%.2f", g->pressure);
+    snprintf(buf, size, " %-8d %-10s %-10.1f %-10s %-10s %-10s %s",
+             g->procs, cpu, g->proc_cpu, rss, mem, psi, g->path[0] ? g->path : "? (no cgroup v2)");
+}
+
+// branch lines in front of a tree row's command, e.g. "| `-+ ". cut off at
+// `w` chars rather than shifted, so the columns still line up. returns the length
+static int tree_prefix(const ProcessList *list, int row, char *buf, int w) {
+    int d = list->tree_depth[row];
+    unsigned long long guides = list->tree_guides[row];
+    int n = 0;
+
+    for (int k = 1; k < d && n + 2 <= w; k++) {
+        buf[n++] = k < TREE_MAX_GUIDES && (guides >> k) & 1 ? '|' : ' ';
+        buf[n++] = ' ';
+    }
+    if (d > 0 && n + 2 <= w) {
+        buf[n++] = d < TREE_MAX_GUIDES && (guides >> d) & 1 ? '|' : '`';
+        buf[n++] = '-';
+    }
+    if ((list->tree_flags[row] & TREE_COLLAPSED) && n < w) buf[n++] = '+';
+    if (n > 0 && n < w) buf[n++] = ' ';
+
+    buf[n] = '\0';
+    return n;
+}
+
+// one cell per core, grouped by NUMA node and socket, colored like the gauges.
+// stays a single pass over the cores however many there are
+static void draw_core_heatmap(int y, int x, int h, int w, const SystemInfo *sys) {
+    static CpuTopology topo;
+    static int topo_cores = -1;
+    static int topo_flat = -1;
+
+    // a recording's cores aren't laid out like this machine's
+    int flat = replay_status[0] != '\0';
+    if (sys->core_count != topo_cores || flat != topo_flat) {
+        if (flat || cpu_topology_load(&topo, sys->core_count) != 0) cpu_topology_flat(&topo, sys->core_count);
+        topo_cores = sys->core_count;
+        topo_flat = flat;
+    }
+    if (topo.cpu_count != sys->core_count) return; // out of memory
+
+    // hottest three first, so they stand out even if the grid gets cut off
+    int hot[3] = {-1, -1, -1};
+    for (int c = 0; c < sys->core_count; c++) {
+        for (int k = 0; k < 3; k++) {
+            if (hot[k] < 0 || sys->core_percents[c] > sys->core_percents[hot[k]]) {
+                memmove(&hot[k + 1], &hot[k], sizeof(int) * (2 - k));
+                hot[k] = c;
+                break;
+            }
+        }
+    }
+    char line[128];
+    int n = snprintf(line, sizeof(line), "%d cores, hot:", sys->core_count);
+    for (int k = 0; k < 3 && hot[k] >= 0; k++) {
+        n += snprintf(line + n, sizeof(line) - n, " %d:%.0f%%", hot[k], sys->core_percents[hot[k]]);
+    }
+    mvaddnstr(y, x, line, w);
+
+    static const char glyphs[] = ".,:;=+*#";
+    int label_w = topo.group_count > 1 ? 7 : 0;
+    int cells_w = w - label_w;
+    if (cells_w < 8) return;
+
+    int row = y + 1;
+    int shown = 0;
+    for (int g = 0; g < topo.group_count && row < y + h; g++) {
+        if (label_w) {
+            int first = topo.order[topo.group_start[g]];
+            char label[16];
+            if (topo.package[first] >= 0) {
+                snprintf(label, sizeof(label), "n%d s%d", topo.node[first], topo.package[first]);
+            } else {
+                snprintf(label, sizeof(label), "n%d", topo.node[first]);
+            }
+            mvaddnstr(row, x, label, label_w - 1);
+        }
+
+        int col = 0;
+        for (int k = topo.group_start[g]; k < topo.group_start[g + 1]; k++) {
+            if (col == cells_w) {
+                col = 0;
+                if (++row >= y + h) break;
+            }
+            float pct = sys->core_percents[topo.order[k]];
+            int level = (int)(pct / 12.5f);
+            if (level < 0) level = 0;
+            if (level > 7) level = 7;
+            int color = PAIR_GAUGE_LOW;
+            if (pct > 75.0f) color = PAIR_GAUGE_HIGH;
+            else if (pct > 50.0f) color = PAIR_GAUGE_MID;
+
+            attron(COLOR_PAIR(color));
+            mvaddch(row, x + label_w + col, glyphs[level]);
+            attroff(COLOR_PAIR(color));
+            col++;
+            shown++;
+        }
+        row++;
+    }
+
+    if (shown < sys->core_count) {
+        char more[16];
+        int m = snprintf(more, sizeof(more), " +%d", sys->core_count - shown);
+        mvaddstr(y + h - 1, x + w - m, more);
+    }
+}
+
 void draw_ui(ProcessList *list, int selected_index, int scroll_offset, SystemInfo *sys_info) {
+    struct timespec t0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
     int height, width;
     getmaxyx(stdscr, height, width);
 
-    bkgd(COLOR_PAIR(PAIR_BG(current_theme)));
-    erase();
-
-    
     int dash_h = 12;  // dashboard height
     int col_w = width / 3;
-    
+    int list_start_y = dash_h;
+    int list_h = height - list_start_y - 1;
+
+    int details_w = 0;
+    int list_width = width;
+    if (show_process_details) {
+        details_w = (int)(width * 0.4);
+        list_width = width - details_w;
+    }
+    int extra_cols = EXTRA_NONE;
+    if (list_width >= EXTRA_COLS_MIN_WIDTH) {
+        if (show_io) extra_cols = EXTRA_IO;
+        else if (show_smaps) extra_cols = EXTRA_SMAPS;
+    }
+    unsigned long long now_ms = monotonic_ms();
+
+    // anything that moves things around means starting from a blank screen
+    Layout layout = { height, width, current_theme, cpu_view, show_process_details,
+                      mem_in_mb, show_help, show_kill_confirm, extra_cols, 0, cgroup_view_active(), "", "" };
+    if (thread_view_active()) layout.threads = thread_view_pid() > 0 ? 1 : 2;
+    memcpy(layout.hostname, sys_info->hostname, sizeof(layout.hostname));
+    memcpy(layout.kernel, sys_info->kernel, sizeof(layout.kernel));
+    int full = !layout_valid || memcmp(&layout, &last_layout, sizeof(layout)) != 0;
+    if (full) {
+        bkgd(COLOR_PAIR(PAIR_BG(current_theme)));
+        erase();
+        memset(row_cache, 0, sizeof(row_cache));
+        last_layout = layout;
+        layout_valid = 1;
+
+        // the parts that only change with the layout
+        draw_box(0, 0, dash_h, col_w, PAIR_BORDER(current_theme), "CPU Info [1:Cores]");
+        draw_box(0, col_w, dash_h, col_w, PAIR_BORDER(current_theme), "Memory Info");
+        draw_box(0, col_w * 2, dash_h, width - col_w * 2, PAIR_BORDER(current_theme), "System");
+        mvprintw(1, col_w*2 + 2, "Host: %s", sys_info->hostname);
+        mvprintw(2, col_w*2 + 2, "Kernel: %s", sys_info->kernel);
+
+        attron(A_BOLD | COLOR_PAIR(PAIR_HEADER(current_theme)));
+        if (layout.threads) {
+            mvprintw(list_start_y, 0, "%-8s %-8s %-16s %-10s %-10s %-10s %s",
+                     " TID", " PID", " NAME", " CPU (%)", " STATE", " CORE", " TIME");
+        } else if (layout.cgroups) {
+            mvprintw(list_start_y, 0, "%-8s %-10s %-10s %-10s %-10s %-10s %s",
+                     " PROCS", " CPU (%)", " PROC CPU", mem_in_mb ? " RSS (MB)" : " RSS (KB)",
+                     mem_in_mb ? " MEM (MB)" : " MEM (KB)", " MEM PSI", " CGROUP");
+        } else if (extra_cols == EXTRA_SMAPS) {
+            mvprintw(list_start_y, 0, "%-8s %-12s %-10s %-10s %-10s %-10s %-10s %-10s %-10s %s",
+                     " PID", " PROG", " USER", mem_in_mb ? " MEM (MB)" : " MEM (KB)", " PSS", " USS", " SWAP",
+                     " CPU (%)", " STATE", " COMMAND");
+        } else if (extra_cols == EXTRA_IO) {
+            mvprintw(list_start_y, 0, "%-8s %-12s %-10s %-10s %-10s %-10s %-10s %-10s %-10s %-10s %s",
+                     " PID", " PROG", " USER", mem_in_mb ? " MEM (MB)" : " MEM (KB)", " READ/s", " WRITE/s",
+                     " RD OPS/s", " WR OPS/s", " CPU (%)", " STATE", " COMMAND");
+        } else {
+            mvprintw(list_start_y, 0, "%-8s %-12s %-10s %-10s %-10s %-10s %s",
+                     " PID", " PROG", " USER", mem_in_mb ? " MEM (MB)" : " MEM (KB)", " CPU (%)", " STATE", " COMMAND");
+        }
+        attroff(A_BOLD | COLOR_PAIR(PAIR_HEADER(current_theme)));
+
+        if (show_process_details) {
+            draw_box(list_start_y, width - details_w, list_h, details_w, PAIR_BORDER(current_theme), "Process Details");
+        }
+    } else {
+        // panel contents get rewritten below, ncurses only sends the cells that differ
+        clear_area(1, 1, dash_h - 2, col_w - 2);
+        clear_area(1, col_w + 1, dash_h - 2, col_w - 2);
+        clear_area(3, col_w*2 + 1, dash_h - 4, width - col_w*2 - 2);
+        if (show_process_details) {
+            clear_area(list_start_y + 1, width - details_w + 1, list_h - 2, details_w - 2);
+        }
+    }
+
     // CPU panel
-    draw_box(0, 0, dash_h, col_w, PAIR_BORDER(current_theme), "CPU Info [1:Cores]");
-    
-    if (show_cpu_cores && sys_info->core_count > 0) {
-        // per-core view - fits up to 20 cores in 2 columns
+    if (cpu_view == CPU_VIEW_HEATMAP && sys_info->core_count > 0) {
+        draw_core_heatmap(1, 2, dash_h - 2, col_w - 4, sys_info);
+    } else if (cpu_view == CPU_VIEW_BARS && sys_info->core_count > 0) {
+        // per-core view - fits up to 20 cores in 2 columns, the heatmap takes the rest
         int cores_per_col = dash_h - 2;
         int col1_w = (col_w - 4) / 2;
-        
+        int fits = cores_per_col * 2;
+        if (sys_info->core_count > fits) {
+            fits--; // last slot says how many are missing
+            mvprintw(cores_per_col, col1_w + 3, "+%d more, 1: heatmap", sys_info->core_count - fits);
+        }
+
         for (int i = 0; i < sys_info->core_count; i++) {
-            if (i >= cores_per_col * 2) break;  // can't fit more
+            if (i >= fits) break;
             
             int row = i % cores_per_col;
             int col_x = (i / cores_per_col) * (col1_w + 1) + 2;
@@ -351,11 +741,11 @@ void draw_ui(ProcessList *list, int selected_index, int scroll_offset, SystemInf
         // aggregate view
         mvprintw(2, 2, "Usage: %5.1f%%", sys_info->cpu_percent);
         draw_bar(3, 2, col_w - 4, sys_info->cpu_percent, 0);
+        mvprintw(5, 2, "Steal: %4.1f%%  Guest: %4.1f%%", sys_info->cpu_steal, sys_info->cpu_guest);
+        mvprintw(6, 2, "Cores: %d", sys_info->core_count);
     }
 
     // Memory panel
-    draw_box(0, col_w, dash_h, col_w, PAIR_BORDER(current_theme), "Memory Info");
-    
     float mem_percent = 0;
     if (sys_info->mem_total > 0) mem_percent = (float)sys_info->mem_used / sys_info->mem_total * 100.0f;
     
@@ -382,12 +772,7 @@ void draw_ui(ProcessList *list, int selected_index, int scroll_offset, SystemInf
         mvprintw(8, x_start, "Swap : Disabled");
     }
     
-    // System info panel
-    draw_box(0, col_w * 2, dash_h, width - col_w * 2, PAIR_BORDER(current_theme), "System");
-    
-    mvprintw(1, col_w*2 + 2, "Host: %s", sys_info->hostname);
-    mvprintw(2, col_w*2 + 2, "Kernel: %s", sys_info->kernel);
-    
+    // System info panel, host and kernel were drawn with the layout
     mvprintw(3, col_w*2 + 2, "CPU Temp: %.1f C", sys_info->cpu_temp);
     if (sys_info->bat_temp > 0) {
         mvprintw(3, col_w*2 + 22, "Bat: %.1f C", sys_info->bat_temp);
@@ -396,85 +781,147 @@ void draw_ui(ProcessList *list, int selected_index, int scroll_offset, SystemInf
     mvprintw(4, col_w*2 + 2, "Load: %.2f %.2f %.2f", sys_info->load_avg[0], sys_info->load_avg[1], sys_info->load_avg[2]);
     mvprintw(5, col_w*2 + 2, "IO R: %.0f K/s W: %.0f K/s", sys_info->disk_read_rate, sys_info->disk_write_rate);
 
-    // Process list
-    int list_start_y = dash_h;
-    int list_h = height - list_start_y - 1;
-    
-    // table header
-    attron(A_BOLD | COLOR_PAIR(PAIR_HEADER(current_theme)));
-    mvprintw(list_start_y, 0, "%-8s %-12s %-10s %-10s %-10s %-10s %s", 
-             " PID", " PROG", " USER", mem_in_mb ? " MEM (MB)" : " MEM (KB)", " CPU (%)", " STATE", " COMMAND");
-    attroff(A_BOLD | COLOR_PAIR(PAIR_HEADER(current_theme)));
-    
-    // process rows
-    for (int i = 0; i < list_h - 1; i++) {
-        int process_idx = scroll_offset + i;
-        if (process_idx >= list->count) break;
+    // process exits caught by the proc connector, newest first
+    int sys_w = width - col_w * 2 - 4;
+    if (sys_info->proc_events) {
+        mvprintw(6, col_w*2 + 2, "Procs: events, %lu exited", sys_info->exits_seen);
+        static long clk_tck = 0;
+        if (!clk_tck) clk_tck = sysconf(_SC_CLK_TCK);
+
+        for (int i = 0; i < sys_info->recent_exit_count && 7 + i < dash_h - 1; i++) {
+            const ProcExit *e = &sys_info->recent_exits[i];
+            const char *name = e->name[0] ? e->name : "?"; // reaped before we could look
+            char line[128];
+            if (e->rss_kb > 0) {
+                snprintf(line, sizeof(line), " %-15s %-7d %6.2fs %6.1fM", name, e->pid,
+                         (double)e->cpu_ticks / clk_tck, e->rss_kb / 1024.0);
+            } else {
+                snprintf(line, sizeof(line), " %-15s %-7d %6.2fs       -", name, e->pid,
+                         (double)e->cpu_ticks / clk_tck);
+            }
+            mvaddnstr(7 + i, col_w*2 + 2, line, sys_w);
+        }
+    } else {
+        mvprintw(6, col_w*2 + 2, "Procs: polling /proc");
+    }
 
-        ProcessInfo *p = &list->processes[process_idx];
+    // process rows - only the ones that look different from last time get repainted.
+    // the thread list takes their place while it's open
+    frame_rows = 0;
+    int row_count = list->visible_count;
+    int first_row = scroll_offset;
+    if (layout.threads) {
+        row_count = thread_view_count();
+        first_row = thread_scroll;
+    } else if (layout.cgroups) {
+        row_count = cgroup_view_count();
+        first_row = cgroup_scroll;
+    }
+    for (int i = 0; i < list_h - 1 && i < ROW_CACHE_MAX; i++) {
+        int process_idx = first_row + i;
+        RowCache *cached = &row_cache[i];
+        int y = list_start_y + 1 + i;
 
-        if (process_idx == selected_index) {
-            attron(COLOR_PAIR(PAIR_SELECT(current_theme)));
+        if (process_idx >= row_count) {
+            // past the end of the list, blank the row if something was there
+            if (!cached->valid || cached->line[0] != '\0') {
+                mvhline(y, 0, ' ', list_width);
+                cached->valid = 1;
+                cached->selected = 0;
+                cached->line[0] = '\0';
+                frame_rows++;
+            }
+            continue;
         }
 
-        char display_cmd[256];
-        int available_width = width;
-        
-        int details_w = 0;
-        int list_width = width;
-        
-        if (show_process_details) {
-            details_w = (int)(width * 0.4);
-            list_width = width - details_w;
-            available_width = list_width;
+        if (layout.threads) {
+            char line_buf[512];
+            format_thread_row(line_buf, sizeof(line_buf), thread_view_row(process_idx));
+            draw_row(y, cached, line_buf, 0, list_width);
+            continue;
+        }
+        if (layout.cgroups) {
+            char line_buf[512];
+            format_cgroup_row(line_buf, sizeof(line_buf), cgroup_view_row(process_idx));
+            draw_row(y, cached, line_buf, 0, list_width);
+            continue;
         }
 
-        // truncate command if too long
+        ProcessInfo info;
+        ProcessInfo *p = visible_process(list, process_idx, &info);
+
+        char display_cmd[256];
+        int available_width = list_width;
+
+        // truncate command if too long - command lines aren't capped anymore,
+        // so never copy more than display_cmd holds
         int cmd_col = 74;
+        if (extra_cols == EXTRA_SMAPS) cmd_col = 107;
+        else if (extra_cols == EXTRA_IO) cmd_col = 118;
+        int cmd_w = 0;
         if (available_width > cmd_col) {
-            strncpy(display_cmd, p->command, available_width - cmd_col - 1);
-            display_cmd[available_width-cmd_col-1] = '\0';
-        } else {
-            if (available_width > 15) {
-                strncpy(display_cmd, p->command, available_width - 15);
-                display_cmd[available_width-15] = '\0';
-            } else {
-                display_cmd[0] = '\0';
+            cmd_w = available_width - cmd_col - 1;
+        } else if (available_width > 15) {
+            cmd_w = available_width - 15;
+        }
+        if (cmd_w > (int)sizeof(display_cmd) - 1) cmd_w = sizeof(display_cmd) - 1;
+
+        long unsigned int mem = p->memory_sq;
+        float cpu = p->cpu_usage;
+        if (list->tree_mode) {
+            int row = list->visible[process_idx];
+            int n = tree_prefix(list, row, display_cmd, cmd_w - 8); // keep a bit of the command
+            snprintf(display_cmd + n, sizeof(display_cmd) - n, "%.*s", cmd_w - n, p->command);
+            // a collapsed row stands in for everything under it
+            if (list->tree_flags[row] & TREE_COLLAPSED) {
+                mem = list->tree_mem[row];
+                cpu = list->tree_cpu[row];
             }
+        } else {
+            snprintf(display_cmd, sizeof(display_cmd), "%.*s", cmd_w, p->command);
         }
 
         char display_name[16];
         strncpy(display_name, p->name, 12);
         display_name[12] = '\0';
 
+        char mem_str[24];
+        if (mem_in_mb) snprintf(mem_str, sizeof(mem_str), "%.1f", (float)mem / 1024.0f);
+        else snprintf(mem_str, sizeof(mem_str), "%lu", mem);
+
         char line_buf[512];
-        if (mem_in_mb) {
-            snprintf(line_buf, sizeof(line_buf), " %-8d %-12s %-10s %-10.1f %-10.1f %-10c %s", 
-                     p->pid, display_name, p->user, (float)p->memory_sq / 1024.0f, p->cpu_usage, p->state, display_cmd);
+        if (extra_cols == EXTRA_SMAPS) {
+            char pss[24], uss[24], swap[24];
+            format_smaps(pss, sizeof(pss), p->pss, p, now_ms);
+            format_smaps(uss, sizeof(uss), p->uss, p, now_ms);
+            format_smaps(swap, sizeof(swap), p->swap, p, now_ms);
+            snprintf(line_buf, sizeof(line_buf), " %-8d %-12s %-10s %-10s %-10s %-10s %-10s %-10.1f %-10c %s",
+                     p->pid, display_name, p->user, mem_str, pss, uss, swap, cpu, p->state, display_cmd);
+        } else if (extra_cols == EXTRA_IO) {
+            char rd[16], wr[16], rd_ops[16], wr_ops[16];
+            format_rate(rd, sizeof(rd), p->io_read_rate, p->io_status);
+            format_rate(wr, sizeof(wr), p->io_write_rate, p->io_status);
+            format_rate(rd_ops, sizeof(rd_ops), p->io_syscr_rate, p->io_status);
+            format_rate(wr_ops, sizeof(wr_ops), p->io_syscw_rate, p->io_status);
+            snprintf(line_buf, sizeof(line_buf), " %-8d %-12s %-10s %-10s %-10s %-10s %-10s %-10s %-10.1f %-10c %s",
+                     p->pid, display_name, p->user, mem_str, rd, wr, rd_ops, wr_ops, cpu, p->state, display_cmd);
         } else {
-            snprintf(line_buf, sizeof(line_buf), " %-8d %-12s %-10s %-10lu %-10.1f %-10c %s", 
-                     p->pid, display_name, p->user, p->memory_sq, p->cpu_usage, p->state, display_cmd);
+            snprintf(line_buf, sizeof(line_buf), " %-8d %-12s %-10s %-10s %-10.1f %-10c %s",
+                     p->pid, display_name, p->user, mem_str, cpu, p->state, display_cmd);
         }
         
-        mvaddnstr(list_start_y + 1 + i, 0, line_buf, list_width);
-        
-        if (process_idx == selected_index) {
-             mvchgat(list_start_y + 1 + i, 0, list_width, A_NORMAL, PAIR_SELECT(current_theme), NULL);
-             attroff(COLOR_PAIR(PAIR_SELECT(current_theme)));
-        }
+        draw_row(y, cached, line_buf, process_idx == selected_index, list_width);
     }
     
-    // Process details sidebar (if enabled)
+    // Process details sidebar (if enabled), the box was drawn with the layout
     if (show_process_details) {
-        int details_w = (int)(width * 0.4);
         int details_x = width - details_w;
         int details_h = list_h;
         int details_y = list_start_y;
 
-        draw_box(details_y, details_x, details_h, details_w, PAIR_BORDER(current_theme), "Process Details");
-        
-        if (selected_index >= 0 && selected_index < list->count) {
-             ProcessInfo *sel = &list->processes[selected_index];
+        if (selected_index >= 0 && selected_index < list->visible_count) {
+             ProcessInfo info;
+             ProcessInfo *sel = visible_process(list, selected_index, &info);
              int tx = details_x + 2;
              int ty = details_y + 2;
              
@@ -489,12 +936,73 @@ void draw_ui(ProcessList *list, int selected_index, int scroll_offset, SystemInf
              mvprintw(ty++, tx, "Prior/Nice: %d / %d", sel->priority, sel->nice);
              
              ty++;
+             // trends over the last HISTORY_LEN refreshes
+             float cpu_hist[HISTORY_LEN], mem_hist[HISTORY_LEN];
+             unsigned long mem_raw[HISTORY_LEN];
+             int samples = history_get(sel->pid, sel->starttime, cpu_hist, mem_raw);
+             int spark_w = details_w - 4 - 18;
+             float mem_lo = 0, mem_hi = 0, cpu_hi = 1.0f;
+             for (int i = 0; i < samples; i++) {
+                 mem_hist[i] = mem_raw[i] / 1024.0f;
+                 if (i == 0 || mem_hist[i] < mem_lo) mem_lo = mem_hist[i];
+                 if (mem_hist[i] > mem_hi) mem_hi = mem_hist[i];
+                 if (cpu_hist[i] > cpu_hi) cpu_hi = cpu_hist[i];
+             }
+
              if (mem_in_mb) {
-                 mvprintw(ty++, tx, "Memory: %.1f MB", (float)sel->memory_sq / 1024.0f);
+                 mvprintw(ty++, tx, "Memory: %.1f MB (peak %.1f MB)", (float)sel->memory_sq / 1024.0f,
+                          (float)sel->rss_peak / 1024.0f);
              } else {
-                 mvprintw(ty++, tx, "Memory: %lu KB", sel->memory_sq);
+                 mvprintw(ty++, tx, "Memory: %lu KB (peak %lu KB)", sel->memory_sq, sel->rss_peak);
+             }
+             if (samples > 1 && spark_w >= 8) {
+                 draw_sparkline(ty, tx + 2, spark_w, mem_hist, samples, mem_lo, mem_hi);
+                 mvprintw(ty++, tx + 3 + spark_w, "%.1f-%.1fM", mem_lo, mem_hi);
+             }
+             if (sel->smaps_status == SMAPS_OK) {
+                 char pss[24], uss[24], swap[24];
+                 format_smaps(pss, sizeof(pss), sel->pss, sel, now_ms);
+                 format_smaps(uss, sizeof(uss), sel->uss, sel, now_ms);
+                 format_smaps(swap, sizeof(swap), sel->swap, sel, now_ms);
+                 mvprintw(ty++, tx, "PSS %s  USS %s  Swap %s %s (%llus ago)", pss, uss, swap,
+                          mem_in_mb ? "MB" : "KB", (now_ms - sel->smaps_ms) / 1000);
+             } else if (show_smaps) {
+                 mvprintw(ty++, tx, "PSS/USS/Swap: %s", sel->smaps_status == SMAPS_DENIED ? "no access" : "not read yet");
              }
              mvprintw(ty++, tx, "CPU: %.1f%%", sel->cpu_usage);
+             if (samples > 1 && spark_w >= 8) {
+                 draw_sparkline(ty, tx + 2, spark_w, cpu_hist, samples, 0.0f, cpu_hi);
+                 mvprintw(ty++, tx + 3 + spark_w, "max %.1f%%", cpu_hi);
+             }
+             if (list->tree_mode) {
+                 int row = list->visible[selected_index];
+                 if (mem_in_mb) {
+                     mvprintw(ty++, tx, "Tree: %d procs, %.1f%% CPU, %.1f MB", list->tree_size[row],
+                              list->tree_cpu[row], list->tree_mem[row] / 1024.0f);
+                 } else {
+                     mvprintw(ty++, tx, "Tree: %d procs, %.1f%% CPU, %lu KB", list->tree_size[row],
+                              list->tree_cpu[row], list->tree_mem[row]);
+                 }
+             }
+             if (sel->io_status == IO_OK) {
+                 char rd[16], wr[16], rd_ops[16], wr_ops[16];
+                 format_rate(rd, sizeof(rd), sel->io_read_rate, sel->io_status);
+                 format_rate(wr, sizeof(wr), sel->io_write_rate, sel->io_status);
+                 format_rate(rd_ops, sizeof(rd_ops), sel->io_syscr_rate, sel->io_status);
+                 format_rate(wr_ops, sizeof(wr_ops), sel->io_syscw_rate, sel->io_status);
+                 mvprintw(ty++, tx, "IO: read %sB/s, write %sB/s", rd, wr);
+                 mvprintw(ty++, tx, "    %s reads/s, %s writes/s", rd_ops, wr_ops);
+             } else if (sel->io_status == IO_DENIED) {
+                 mvprintw(ty++, tx, "IO: no access");
+             }
+             if (sel->cgroup[0]) {
+                 mvprintw(ty++, tx, "Cgroup: %.*s", details_w - 12, sel->cgroup);
+             }
+             if (sel->cpu_delay || sel->io_delay) {
+                 // delay accounting, only the taskstats backend has it
+                 mvprintw(ty++, tx, "Delay: CPU %.0f ms, IO %.0f ms",
+                          sel->cpu_delay / 1e6, sel->io_delay / 1e6);
+             }
              
              ty++;
              mvprintw(ty++, tx, "Command:");
@@ -515,6 +1023,15 @@ void draw_ui(ProcessList *list, int selected_index, int scroll_offset, SystemInf
     const char *sort_str = "PID";
     if (list->sort_mode == SORT_MEM) sort_str = "MEM";
     if (list->sort_mode == SORT_CPU) sort_str = "CPU";
+    if (list->sort_mode == SORT_PSS) sort_str = "PSS";
+    if (list->sort_mode == SORT_IO) sort_str = "IO";
+    if (list->tree_mode) {
+        if (list->sort_mode == SORT_MEM) sort_str = "Tree/MEM";
+        else if (list->sort_mode == SORT_CPU) sort_str = "Tree/CPU";
+        else if (list->sort_mode == SORT_PSS) sort_str = "Tree/PSS";
+        else if (list->sort_mode == SORT_IO) sort_str = "Tree/IO";
+        else sort_str = "Tree/PID";
+    }
     
     const char *theme_str = "Def";
     if (current_theme == THEME_DRACULA) theme_str = "Drac";
@@ -534,12 +1051,33 @@ void draw_ui(ProcessList *list, int selected_index, int scroll_offset, SystemInf
         attron(A_REVERSE);
         printw("SEARCH: %s_", list->filter);
         attroff(A_REVERSE);
+    } else if (replay_status[0] != '\0') {
+        attron(A_REVERSE);
+        printw("%s", replay_status);
+        attroff(A_REVERSE);
+        if (list->filter[0] != '\0') printw(" | Filter: %s (%d)", list->filter, list->visible_count);
+    } else if (layout.cgroups) {
+         printw("Cgroups: %d | j/k:Scroll | Esc:Back", cgroup_view_count());
+    } else if (layout.threads) {
+         if (thread_view_gone()) printw("%s: process exited | Esc:Back", thread_title);
+         else printw("%s: %d threads | j/k:Scroll | Esc:Back", thread_title, thread_view_count());
     } else if (list->filter[0] != '\0') {
-         printw("Filter: %s (Esc to clear) | Found: %d", list->filter, list->count);
+         printw("Filter: %s (Esc to clear) | Found: %d", list->filter, list->visible_count);
     } else {
          printw("Total: %d | Sort: %s | Theme: %s | /:Search | q:Quit | H:Help | t:Theme | M:MemUnit | K:Kill", 
                  list->count, sort_str, theme_str);
     }
+
+    if (show_stats) {
+        // bytes and time are from the previous frame, this one isn't out yet
+        char stats[64];
+        int n = snprintf(stats, sizeof(stats), " %llu B | %ld us | %d rows ", frame_bytes, frame_us, frame_rows);
+        if (n < width) {
+            attron(A_REVERSE);
+            mvaddstr(height - 1, width - n, stats);
+            attroff(A_REVERSE);
+        }
+    }
     
     if (show_kill_confirm) {
         draw_kill_confirm_popup(kill_confirm_pid, kill_confirm_name);
@@ -548,8 +1086,18 @@ void draw_ui(ProcessList *list, int selected_index, int scroll_offset, SystemInf
     if (show_help) {
         draw_help_menu();
     }
-    
-    refresh();
+
+    if (show_stats) {
+        unsigned long long before = written_bytes();
+        refresh();
+        frame_bytes = written_bytes() - before;
+    } else {
+        refresh();
+    }
+
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    frame_us = (t1.tv_sec - t0.tv_sec) * 1000000L + (t1.tv_nsec - t0.tv_nsec) / 1000;
 }
 
 int handle_input(int ch, ProcessList *list, int *selected_index, int *scroll_offset) {
@@ -565,7 +1113,7 @@ int handle_input(int ch, ProcessList *list, int *selected_index, int *scroll_off
         if (ch == 27) {  // ESC
             is_searching = 0;
             list->filter[0] = '\0';
-            return ACTION_REFRESH;
+            return ACTION_FILTER;
         } else if (ch == '\n' || ch == KEY_ENTER) {
             is_searching = 0;
             return ACTION_REDRAW;
@@ -573,14 +1121,14 @@ int handle_input(int ch, ProcessList *list, int *selected_index, int *scroll_off
             size_t len = strlen(list->filter);
             if (len > 0) {
                 list->filter[len - 1] = '\0';
-                return ACTION_REFRESH;
+                return ACTION_FILTER;
             }
         } else if (ch >= 32 && ch <= 126) {  // printable chars
             size_t len = strlen(list->filter);
             if (len < sizeof(list->filter) - 1) {
                 list->filter[len] = (char)ch;
                 list->filter[len + 1] = '\0';
-                return ACTION_REFRESH;
+                return ACTION_FILTER;
             }
         }
         return ACTION_NONE;
@@ -626,7 +1174,53 @@ int handle_input(int ch, ProcessList *list, int *selected_index, int *scroll_off
         return ACTION_NONE;
     }
 
+    // thread list: it has its own scrolling, the rest still goes to the process list
+    if (thread_view_active()) {
+        int last = thread_view_count() - list_height;
+        if (last < 0) last = 0;
+        if (ch == 27 || ch == 'd' || ch == 'D') {
+            thread_view_close();
+            return ACTION_REDRAW;
+        } else if (ch == 'j' || ch == KEY_DOWN) {
+            if (thread_scroll < last) thread_scroll++;
+            return ACTION_REDRAW;
+        } else if (ch == 'k' || ch == KEY_UP) {
+            if (thread_scroll > 0) thread_scroll--;
+            return ACTION_REDRAW;
+        } else if (ch == 'g') {
+            thread_scroll = 0;
+            return ACTION_REDRAW;
+        } else if (ch == 'G') {
+            thread_scroll = last;
+            return ACTION_REDRAW;
+        }
+    }
+
+    // cgroup list, the same way
+    if (cgroup_view_active()) {
+        int last = cgroup_view_count() - list_height;
+        if (last < 0) last = 0;
+        if (ch == 27 || ch == 'C') {
+            cgroup_view_close();
+            return ACTION_REDRAW;
+        } else if (ch == 'j' || ch == KEY_DOWN) {
+            if (cgroup_scroll < last) cgroup_scroll++;
+            return ACTION_REDRAW;
+        } else if (ch == 'k' || ch == KEY_UP) {
+            if (cgroup_scroll > 0) cgroup_scroll--;
+            return ACTION_REDRAW;
+        } else if (ch == 'g') {
+            cgroup_scroll = 0;
+            return ACTION_REDRAW;
+        } else if (ch == 'G') {
+            cgroup_scroll = last;
+            return ACTION_REDRAW;
+        }
+    }
+
     switch (ch) {
+        case KEY_RESIZE:
+            return ACTION_REDRAW; // draw_ui() notices the new size and starts over
         case KEY_MOUSE: {
             MEVENT event;
             if (getmouse(&event) == OK) {
@@ -639,7 +1233,7 @@ int handle_input(int ch, ProcessList *list, int *selected_index, int *scroll_off
                     }
                 }
                 if (event.bstate & (BUTTON5_PRESSED | 2097152)) {  // scroll down
-                    if (*selected_index < list->count - 1) {
+                    if (*selected_index < list->visible_count - 1) {
                          (*selected_index)++;
                          if (*selected_index >= *scroll_offset + list_height) (*scroll_offset)++;
                          return ACTION_REDRAW;
@@ -654,7 +1248,7 @@ int handle_input(int ch, ProcessList *list, int *selected_index, int *scroll_off
                         }
                     }
                     if (event.bstate & BUTTON5_PRESSED) {
-                        if (*selected_index < list->count - 1) {
+                        if (*selected_index < list->visible_count - 1) {
                              (*selected_index)++;
                              if (*selected_index >= *scroll_offset + list_height) (*scroll_offset)++;
                              return ACTION_REDRAW;
@@ -665,22 +1259,22 @@ int handle_input(int ch, ProcessList *list, int *selected_index, int *scroll_off
             break;
         }
         case '1':
-            show_cpu_cores = !show_cpu_cores;
+            cpu_view = (cpu_view + 1) % CPU_VIEW_COUNT;
             return ACTION_REDRAW;
         case '/':
             is_searching = 1;
             list->filter[0] = '\0';
-            return ACTION_REFRESH;
+            return ACTION_FILTER;
         case 'g':
             pending_g = 1;
             break;
         case 'G':  // jump to bottom
-            *selected_index = list->count - 1;
+            *selected_index = list->visible_count - 1;
             if (*selected_index < 0) *selected_index = 0;
             if (*selected_index >= *scroll_offset + list_height) {
                 *scroll_offset = *selected_index - list_height + 1;
             }
-            if (list->count < list_height) {
+            if (list->visible_count < list_height) {
                 *scroll_offset = 0;
             }
             return ACTION_REDRAW;
@@ -700,7 +1294,7 @@ int handle_input(int ch, ProcessList *list, int *selected_index, int *scroll_off
             break;
         case KEY_DOWN:
         case 'j':
-            if (*selected_index < list->count - 1) {
+            if (*selected_index < list->visible_count - 1) {
                 (*selected_index)++;
                 if (*selected_index >= *scroll_offset + list_height) {
                     (*scroll_offset)++;
@@ -709,9 +1303,12 @@ int handle_input(int ch, ProcessList *list, int *selected_index, int *scroll_off
             }
             break;
         case 'K':  // kill process confirmation
-            if (list->count > 0 && *selected_index < list->count) {
-                 kill_confirm_pid = list->processes[*selected_index].pid;
-                 strncpy(kill_confirm_name, list->processes[*selected_index].name, sizeof(kill_confirm_name) - 1);
+            if (replay_status[0] != '\0') break; // not a live list
+            if (list->visible_count > 0 && *selected_index < list->visible_count) {
+                 ProcessInfo info;
+                 ProcessInfo *sel = visible_process(list, *selected_index, &info);
+                 kill_confirm_pid = sel->pid;
+                 strncpy(kill_confirm_name, sel->name, sizeof(kill_confirm_name) - 1);
                  kill_confirm_name[sizeof(kill_confirm_name) - 1] = '\0';
                  show_kill_confirm = 1;
                  kill_confirm_selected = 0; // default to Yes
@@ -733,9 +1330,72 @@ int handle_input(int ch, ProcessList *list, int *selected_index, int *scroll_off
             list->sort_mode = SORT_PID;
             sort_process_list(list);
             return ACTION_REDRAW;
+        case 'P':
+            list->sort_mode = SORT_PSS;
+            show_io = 0; // show what it's sorted by
+            sort_process_list(list);
+            return ACTION_REDRAW;
+        case 'i':
+            list->sort_mode = SORT_IO;
+            show_io = 1;
+            sort_process_list(list);
+            return ACTION_REDRAW;
+        case 'I':
+            show_io = !show_io;
+            return ACTION_REDRAW;
+        case 'd':  // threads of the selected process
+            if (replay_status[0] == '\0' && *selected_index < list->visible_count) {
+                ProcessInfo info;
+                ProcessInfo *sel = visible_process(list, *selected_index, &info);
+                snprintf(thread_title, sizeof(thread_title), "Threads of %d (%s)", sel->pid, sel->name);
+                thread_scroll = 0;
+                cgroup_view_close();
+                thread_view_open(sel->pid, sel->starttime);
+                return ACTION_REDRAW;
+            }
+            break;
+        case 'D':  // every thread on the host
+            if (replay_status[0] == '\0') {
+                snprintf(thread_title, sizeof(thread_title), "All threads");
+                thread_scroll = 0;
+                cgroup_view_close();
+                thread_view_open(0, 0);
+                return ACTION_REDRAW;
+            }
+            break;
+        case 'C':  // group by cgroup, recordings don't have them
+            if (replay_status[0] == '\0') {
+                cgroup_scroll = 0;
+                thread_view_close();
+                cgroup_view_open();
+                cgroup_view_update(list);
+                return ACTION_REDRAW;
+            }
+            break;
         case 't':
             toggle_theme();
             return ACTION_REDRAW;
+        case 'T': {
+            // stay on the same process, its row moves around
+            pid_t pid = -1;
+            if (*selected_index < list->visible_count) pid = visible_pid(list, *selected_index);
+            list->tree_mode = !list->tree_mode;
+            sort_process_list(list);
+            int row = pid != -1 ? find_visible_row(list, pid) : -1;
+            if (row >= 0) *selected_index = row;
+            return ACTION_FILTER; // re-clamps the selection
+        }
+        case '-':
+        case '+':
+        case '=':
+            if (list->tree_mode && *selected_index < list->visible_count) {
+                collapse_process_tree(list, list->visible[*selected_index], ch == '-');
+                return ACTION_REDRAW;
+            }
+            break;
+        case 'R':  // hostname, kernel and sensor paths are cached, look again
+            system_info_rescan();
+            return ACTION_REFRESH;
         case '\n':
         case KEY_ENTER:
             show_process_details = !show_process_details;
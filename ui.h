@@ -6,6 +6,7 @@
 #define ACTION_NONE 0
 #define ACTION_REDRAW 1
 #define ACTION_REFRESH 2
+#define ACTION_FILTER 3   // filter text changed, re-filter the current snapshot
 
 void init_ui();
 void cleanup_ui();
@@ -13,5 +14,9 @@ void draw_ui(ProcessList *list, int selected_index, int scroll_offset, SystemInf
 int handle_input(int ch, ProcessList *list, int *selected_index, int *scroll_offset);
 void toggle_theme();
 void reset_search_mode();
+void ui_set_replay(const char *status);
+int ui_input_captured(void);
+void ui_show_stats(int enabled);
+void ui_show_smaps(int enabled);
 
 #endif
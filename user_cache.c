@@ -0,0 +1,100 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pwd.h>
+#include <sys/stat.h>
+#include "user_cache.h"
+
+typedef struct {
+    uid_t uid;
+    int used;
+    char name[32];
+} UserEntry;
+
+static UserEntry *entries = NULL;
+static int table_size = 0;   // power of two
+static int entry_count = 0;
+static unsigned int generation = 0;
+
+static int watch_passwd = 1;
+static struct timespec passwd_mtime;
+static int passwd_checked = 0;
+
+static unsigned int hash_uid(uid_t uid) {
+    return (unsigned int)uid * 2654435761u;
+}
+
+static UserEntry* find_slot(UserEntry *table, int size, uid_t uid) {
+    unsigned int mask = (unsigned int)size - 1;
+    unsigned int slot = hash_uid(uid) & mask;
+    while (table[slot].used && table[slot].uid != uid) slot = (slot + 1) & mask;
+    return &table[slot];
+}
+
+static int grow_table(void) {
+    int new_size = table_size ? table_size * 2 : 64;
+    UserEntry *new_entries = calloc(new_size, sizeof(UserEntry));
+    if (!new_entries) return -1;
+
+    for (int i = 0; i < table_size; i++) {
+        if (entries[i].used) *find_slot(new_entries, new_size, entries[i].uid) = entries[i];
+    }
+    free(entries);
+    entries = new_entries;
+    table_size = new_size;
+    return 0;
+}
+
+void user_cache_clear(void) {
+    if (entries) memset(entries, 0, sizeof(UserEntry) * table_size);
+    entry_count = 0;
+    generation++;
+}
+
+unsigned int user_cache_generation(void) {
+    return generation;
+}
+
+void user_cache_set_watch_passwd(int enabled) {
+    watch_passwd = enabled;
+}
+
+// call once per refresh - drops the cache when /etc/passwd was modified
+void user_cache_revalidate(void) {
+    if (!watch_passwd) return;
+
+    struct stat st;
+    if (stat("/etc/passwd", &st) != 0) return;
+
+    if (passwd_checked && (st.st_mtim.tv_sec != passwd_mtime.tv_sec ||
+                           st.st_mtim.tv_nsec != passwd_mtime.tv_nsec)) {
+        user_cache_clear();
+    }
+    passwd_mtime = st.st_mtim;
+    passwd_checked = 1;
+}
+
+// returned string stays valid until the next lookup that adds an entry
+const char* lookup_user_name(uid_t uid) {
+    if (entry_count * 2 >= table_size && grow_table() != 0) {
+        static char fallback[32];
+        snprintf(fallback, sizeof(fallback), "%d", uid);
+        return fallback;
+    }
+
+    UserEntry *e = find_slot(entries, table_size, uid);
+    if (e->used) return e->name;
+
+    struct passwd *pw = getpwuid(uid);
+    if (pw) {
+        strncpy(e->name, pw->pw_name, sizeof(e->name) - 1);
+        e->name[sizeof(e->name) - 1] = '\0';
+    } else {
+        snprintf(e->name, sizeof(e->name), "%d", uid); // fallback to UID
+    }
+    e->uid = uid;
+    e->used = 1;
+    entry_count++;
+    return e->name;
+}
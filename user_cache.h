@@ -0,0 +1,18 @@
+#ifndef USER_CACHE_H
+#define USER_CACHE_H
+
+#include <sys/types.h>
+
+// uid -> user name cache so getpwuid() (and whatever NSS backend is behind it)
+// only gets called the first time we see a uid
+
+const char* lookup_user_name(uid_t uid);
+void user_cache_revalidate(void);
+void user_cache_set_watch_passwd(int enabled);
+void user_cache_clear(void);
+
+// bumped whenever the cache is dropped, names resolved under an older
+// generation may be stale
+unsigned int user_cache_generation(void);
+
+#endif